@@ -21,11 +21,81 @@
 #include "itkNonLocalPatchBasedImageFilter.h"
 
 #include "itkConstNeighborhoodIterator.h"
-#include "itkGaussianOperator.h"
+#include "itkMath.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
 
 namespace itk
 {
 
+/**
+ * \class AdaptiveNonLocalMeansDenoisingImageFilterEnums
+ * \brief Adaptive non-local means denoising image filter enum classes.
+ * \ingroup AdaptiveDenoising
+ */
+
+class AdaptiveNonLocalMeansDenoisingImageFilterEnums
+{
+public:
+  /**\class PatchDistanceEngine
+   * \brief Algorithm used to compute the patch distances of the search.
+   *
+   * DIRECT sums the squared residual differences of every (center, neighbor)
+   * pair, at a cost proportional to the patch size.  SUMMED_AREA_TABLE visits
+   * the search offsets one at a time and builds a summed-area table of the
+   * squared residual differences for that offset, from which every patch
+   * distance is read in constant time (Darbon et al., "Fast nonlocal
+   * filtering applied to electron cryomicroscopy", ISBI 2008).
+   * \ingroup AdaptiveDenoising
+   */
+  enum class PatchDistanceEngine : uint8_t
+  {
+    DIRECT = 0,
+    SUMMED_AREA_TABLE = 1
+  };
+
+  /**\class RicianBiasSmoother
+   * \brief Filter used to smooth the Rician bias map.
+   *
+   * DISCRETE_GAUSSIAN convolves the bias map with a truncated Gaussian kernel
+   * (DiscreteGaussianImageFilter), at a cost per voxel proportional to the
+   * kernel width.  RECURSIVE_GAUSSIAN approximates the Gaussian with a
+   * recursive filter (SmoothingRecursiveGaussianImageFilter, Deriche), at a
+   * cost per voxel which does not depend on the smoothing variance.
+   * \ingroup AdaptiveDenoising
+   */
+  enum class RicianBiasSmoother : uint8_t
+  {
+    DISCRETE_GAUSSIAN = 0,
+    RECURSIVE_GAUSSIAN = 1
+  };
+
+  /**\class AuxiliaryImagePrecision
+   * \brief Storage precision of the auxiliary images read by the search.
+   *
+   * SINGLE stores the local mean, variance and residual images as RealType.
+   * HALF stores them as IEEE 754 half precision floats (16 bits, 11
+   * significant bits), each image scaled by a power of two which keeps its
+   * values in the half precision range.  The values are expanded to RealType
+   * as they are read, and all the arithmetic stays in RealType.
+   * \ingroup AdaptiveDenoising
+   */
+  enum class AuxiliaryImagePrecision : uint8_t
+  {
+    SINGLE = 0,
+    HALF = 1
+  };
+};
+
+extern AdaptiveDenoising_EXPORT std::ostream &
+operator<<(std::ostream & out, const AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine value);
+extern AdaptiveDenoising_EXPORT std::ostream &
+operator<<(std::ostream & out, const AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother value);
+extern AdaptiveDenoising_EXPORT std::ostream &
+operator<<(std::ostream & out, const AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision value);
+
 /**
  * \class AdaptiveNonLocalMeansDenoisingImageFilter
  * \brief Implementation of a denoising image filter.
@@ -41,6 +111,27 @@ namespace itk
  * Spatially Varying Noise Levels, Journal of Magnetic Resonance Imaging,
  * 31:192-203, June 2010.
  *
+ * \par MULTITHREADING
+ *
+ * Each center voxel spreads its weighted patch estimate over every voxel of
+ * its patch, so the patches of neighboring centers overlap.  The requested
+ * region is therefore split into slabs along the slowest axis which are
+ * scheduled dynamically over the available threads.  Each slab accumulates
+ * into its own buffers (the slab plus a halo of one patch radius) and the
+ * buffers are merged in slab order once all slabs are done.  The merge order
+ * does not depend on the number of threads, so results are reproducible.
+ *
+ * \par SIMILARITY METRIC
+ *
+ * With MEAN_SQUARES the distance between two patches is the mean squared
+ * difference of their residuals (input minus local mean).  With
+ * PEARSON_CORRELATION it is 2 s^2 (1 - r), where r is the correlation of the
+ * two residual patches and s^2 the variance of the residual patch of the
+ * center: the mean squared difference once the neighbor patch is matched to
+ * the mean and standard deviation of the center patch.  The mean and inverse
+ * standard deviation of every residual patch are computed once, before the
+ * search.  The distances of both metrics then weigh the neighbors alike.
+ *
  * \ingroup AdaptiveDenoising
  */
 
@@ -69,10 +160,11 @@ public:
   static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
 
   /** Some convenient typedefs. */
-  typedef TInputImage                        InputImageType;
-  typedef typename InputImageType::PixelType InputPixelType;
-  typedef TOutputImage                       OutputImageType;
-  typedef typename Superclass::RegionType    RegionType;
+  typedef TInputImage                         InputImageType;
+  typedef typename InputImageType::PixelType  InputPixelType;
+  typedef TOutputImage                        OutputImageType;
+  typedef typename OutputImageType::PixelType OutputPixelType;
+  typedef typename Superclass::RegionType     RegionType;
 
   typedef TMaskImage                        MaskImageType;
   typedef typename MaskImageType::PixelType MaskPixelType;
@@ -82,13 +174,32 @@ public:
   typedef typename Superclass::RealImageType    RealImageType;
   typedef typename Superclass::RealImagePointer RealImagePointer;
   typedef typename Superclass::IndexType        IndexType;
+  typedef typename RegionType::SizeType         CenterStrideType;
 
+  typedef typename Superclass::NeighborhoodType              NeighborhoodType;
   typedef typename Superclass::ConstNeighborhoodIteratorType ConstNeighborhoodIteratorType;
   typedef typename Superclass::NeighborhoodRadiusType        NeighborhoodRadiusType;
   typedef typename Superclass::NeighborhoodOffsetType        NeighborhoodOffsetType;
   typedef typename Superclass::NeighborhoodOffsetListType    NeighborhoodOffsetListType;
+  typedef typename Superclass::SearchStrategyEnum            SearchStrategyEnum;
+  typedef typename Superclass::SimilarityMetricEnum          SimilarityMetricEnum;
 
-  typedef GaussianOperator<RealType> ModifiedBesselCalculatorType;
+  typedef AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine     PatchDistanceEngineEnum;
+  typedef AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother      RicianBiasSmootherEnum;
+  typedef AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision AuxiliaryImagePrecisionEnum;
+
+  /**
+   * Denoising parameters varied by a parameter sweep, with the defaults of
+   * the filter.
+   */
+  struct SweepParameters
+  {
+    RealType m_SmoothingFactor{ 1.0 };
+    RealType m_MeanThreshold{ 0.95 };
+    RealType m_VarianceThreshold{ 0.5 };
+    RealType m_SmoothingVariance{ 2.0 };
+  };
+  typedef std::vector<SweepParameters> SweepParametersListType;
 
   /**
    * The image expected for input for noise correction.
@@ -124,6 +235,39 @@ public:
     return static_cast<const MaskImageType *>(this->ProcessObject::GetInput(1));
   }
 
+  /**
+   * Precomputed local mean and variance of the input image over the
+   * NeighborhoodRadiusForLocalMeanAndVariance neighborhood, e.g. the
+   * LocalMean and LocalVariance outputs of an earlier run on the same image.
+   * When both are set the local statistics of the input image are not
+   * computed, and its residuals are formed from the given mean.  They must
+   * span the same largest possible region as the input image.
+   */
+  itkSetInputMacro(LocalMeanImage, RealImageType);
+  itkGetInputMacro(LocalMeanImage, RealImageType);
+  itkSetInputMacro(LocalVarianceImage, RealImageType);
+  itkGetInputMacro(LocalVarianceImage, RealImageType);
+
+  /**
+   * Co-registered channels denoised with the patch weights of the input image
+   * (e.g. the gradient volumes of a diffusion-weighted acquisition, or the
+   * echoes of a multi-echo sequence).  The search, the preselection and the
+   * patch distances are computed once, on the input image which acts as the
+   * guide, and the weights are applied to every channel in the same pass.
+   * Channel 0 is the input image itself and channel i is written to the i-th
+   * output.  With the Rician noise model the bias of every channel is
+   * estimated from its own residuals.  The components of a VectorImage can be
+   * extracted with VectorIndexSelectionCastImageFilter.
+   */
+  void
+  SetChannel(unsigned int, const InputImageType *);
+  const InputImageType *
+  GetChannel(unsigned int) const;
+
+  /** Number of channels, including the input image. */
+  unsigned int
+  GetNumberOfChannels() const;
+
   /**
    * Employ Rician noise model.  Otherwise use a Gaussian noise model.
    * Default = true.
@@ -133,7 +277,9 @@ public:
   itkBooleanMacro(UseRicianNoiseModel);
 
   /**
-   * Smoothing factor for noise.  Default = 1.0.
+   * Smoothing factor for noise.  The weight of a neighbor at the patch
+   * distance d is exp(-d / (SmoothingFactor * minimum distance)), so larger
+   * values smooth more.  Default = 1.0.
    */
   itkSetMacro(SmoothingFactor, RealType);
   itkGetConstMacro(SmoothingFactor, RealType);
@@ -144,6 +290,23 @@ public:
   itkSetMacro(SmoothingVariance, RealType);
   itkGetConstMacro(SmoothingVariance, RealType);
 
+  /**
+   * Filter used to smooth the Rician bias map.  RECURSIVE_GAUSSIAN costs the
+   * same for any smoothing variance and smooths the bias map in place, but its
+   * support is unbounded, so the bias map is computed over the whole image
+   * for every requested region and streaming brings no savings.  Every axis
+   * of the image must then span at least 4 voxels.  The two filters differ
+   * mostly through the truncation of the discrete kernel, which drops the
+   * tails of the Gaussian beyond the default maximum error of
+   * DiscreteGaussianImageFilter (1%) or its maximum kernel width (32).  The
+   * smoothed bias maps thus agree to within about 1% of the range of the
+   * bias, and less closely for the smoothing variances whose kernel is cut
+   * at the maximum width, and the denoised outputs differ accordingly.
+   * Default = DISCRETE_GAUSSIAN.
+   */
+  itkSetMacro(RicianBiasSmoother, RicianBiasSmootherEnum);
+  itkGetConstMacro(RicianBiasSmoother, RicianBiasSmootherEnum);
+
   /**
    * Epsilon for minimum value of mean and variance at a pixel.
    * Default = 0.00001.
@@ -172,6 +335,211 @@ public:
   itkSetMacro(NeighborhoodRadiusForLocalMeanAndVariance, NeighborhoodRadiusType);
   itkGetConstMacro(NeighborhoodRadiusForLocalMeanAndVariance, NeighborhoodRadiusType);
 
+  /**
+   * Step between consecutive patch centers along each axis (the block step of
+   * the blockwise non-local means of Coupe et al.).  Only every k-th voxel,
+   * plus the last voxel of each axis, is processed as a center while the
+   * overlapping patches still cover every voxel.  Each component must not
+   * exceed the patch size along that axis.  Default = 1x1x...
+   */
+  itkSetMacro(CenterStride, CenterStrideType);
+  itkGetConstMacro(CenterStride, CenterStrideType);
+
+  /**
+   * Algorithm used to compute the patch distances.  SUMMED_AREA_TABLE costs a
+   * constant number of operations per (center, neighbor) pair regardless of
+   * the patch radius, which pays off for larger patches (e.g. radius 2 or 3
+   * in 3-D).  Both engines produce the same result up to floating point
+   * round-off.  Default = DIRECT.
+   */
+  itkSetMacro(PatchDistanceEngine, PatchDistanceEngineEnum);
+  itkGetConstMacro(PatchDistanceEngine, PatchDistanceEngineEnum);
+
+  /**
+   * Stop accumulating the distance between two patches as soon as it is
+   * certain to exceed the cutoff (three times the minimum distance) beyond
+   * which the neighbor gets no weight.  The partial sums are checked after
+   * every patch row, and the result is identical to the full computation.
+   * Only the DIRECT engine, away from the image boundary, is concerned.
+   * Default = true.
+   */
+  itkSetMacro(UsePatchDistanceEarlyTermination, bool);
+  itkGetConstMacro(UsePatchDistanceEarlyTermination, bool);
+  itkBooleanMacro(UsePatchDistanceEarlyTermination);
+
+  /**
+   * Compute the distance between the patches of two centers of the same slab
+   * once rather than from each of them.  The patch distance is symmetric, so
+   * the distance computed for a center is kept for its neighbor further along
+   * in raster order, which reads it back when it becomes the center.  The
+   * result is identical.  The distances are kept in a ring buffer per work
+   * unit, of about (number of search offsets / 2) values for every voxel
+   * within the search extent ahead of the current center in raster order
+   * (several image slices in 3D).  Only the DIRECT engine with the
+   * SEARCH_NEIGHBORHOOD strategy is concerned.  Default = false.
+   */
+  itkSetMacro(UseSymmetricPatchDistances, bool);
+  itkGetConstMacro(UseSymmetricPatchDistances, bool);
+  itkBooleanMacro(UseSymmetricPatchDistances);
+
+  /**
+   * Coarse-to-fine preselection of the search offsets.  A first search on the
+   * residuals averaged over cells of 2x2x... voxels keeps, for every cell, its
+   * NumberOfCoarseSearchCandidates most similar offsets between cells.  The
+   * centers of the cell then only search the offsets within
+   * CoarseSearchRefinementRadius voxels of twice these coarse offsets, on top
+   * of the mean and variance preselection.  This makes large search
+   * neighborhoods affordable, at the price of an approximate search.  It
+   * requires the DIRECT patch distance engine.  Default = false.
+   */
+  itkSetMacro(UseCoarseToFineSearch, bool);
+  itkGetConstMacro(UseCoarseToFineSearch, bool);
+  itkBooleanMacro(UseCoarseToFineSearch);
+
+  /** Number of coarse offsets kept for every cell.  Default = 8. */
+  itkSetMacro(NumberOfCoarseSearchCandidates, unsigned int);
+  itkGetConstMacro(NumberOfCoarseSearchCandidates, unsigned int);
+
+  /** Radius, in voxels, of the refinement about every coarse offset.  Default = 1. */
+  itkSetMacro(CoarseSearchRefinementRadius, unsigned int);
+  itkGetConstMacro(CoarseSearchRefinementRadius, unsigned int);
+
+  /**
+   * Only process the part of the image which the mask reaches.  Every slab is
+   * cropped to the centers whose patch overlaps a masked voxel of the slab,
+   * and slabs without any are dropped before being scheduled.  The local
+   * statistics and the Rician bias map only cover the bounding box of the
+   * mask and its halo.  Voxels inside the mask are identical to those of the
+   * full computation (up to round-off with the SUMMED_AREA_TABLE engine);
+   * voxels outside it keep their input intensity.  It has no effect without a
+   * mask image.  Default = false.
+   */
+  itkSetMacro(UseMaskedExecution, bool);
+  itkGetConstMacro(UseMaskedExecution, bool);
+  itkBooleanMacro(UseMaskedExecution);
+
+  /**
+   * Visit the centers of every slab tile by tile rather than in raster order
+   * over the whole slab.  The tiles split the slab along all but its slowest
+   * axis, and are as large as possible while the search windows and patches
+   * of their centers (input, mean, variance and residual) fit in
+   * TileCacheSize bytes.  The input, mean and variance of every tile and its
+   * search halo are first gathered into one interleaved buffer, so that the
+   * preselection of a neighbor reads a single cache line.  The result is
+   * identical up to floating point round-off.  Only the DIRECT engine is
+   * concerned.  Default = false.
+   */
+  itkSetMacro(UseTiledTraversal, bool);
+  itkGetConstMacro(UseTiledTraversal, bool);
+  itkBooleanMacro(UseTiledTraversal);
+
+  /** Size, in bytes, of the cache the tiles are fitted to.  Default = 262144. */
+  itkSetMacro(TileCacheSize, SizeValueType);
+  itkGetConstMacro(TileCacheSize, SizeValueType);
+
+  /**
+   * Storage precision of the local mean, variance and residual images which
+   * the search reads.  HALF stores them as IEEE half floats scaled by a power
+   * of two, and expands them as they are read, so the patch distances,
+   * weights and estimates are still accumulated in RealType.  It halves the
+   * footprint and bandwidth of these images during the search, but not the
+   * peak memory of the preprocessing, and the expansion costs more than it
+   * saves when they already fit in the cache.  The images are rounded to 11
+   * significant bits, which barely moves the patch distances but may move a
+   * neighbor lying at a preselection threshold to its other side.  The output
+   * then differs from that of SINGLE at a few voxels, by a small fraction of
+   * the intensity range.  HALF requires the DIRECT patch distance engine
+   * and the SEARCH_NEIGHBORHOOD strategy, without the coarse-to-fine search.
+   * Default = SINGLE.
+   */
+  itkSetMacro(AuxiliaryImagePrecision, AuxiliaryImagePrecisionEnum);
+  itkGetConstMacro(AuxiliaryImagePrecision, AuxiliaryImagePrecisionEnum);
+
+  /**
+   * Compute the maximum intensity of the input image, used by the mean
+   * preselection, from the whole input image.  This requires the whole input
+   * image, so to stream the filter turn it off and set the maximum intensity
+   * explicitly (e.g. from a StatisticsImageFilter).  Default = true.
+   */
+  itkSetMacro(ComputeMaximumInputPixelIntensity, bool);
+  itkGetConstMacro(ComputeMaximumInputPixelIntensity, bool);
+  itkBooleanMacro(ComputeMaximumInputPixelIntensity);
+
+  /**
+   * Maximum intensity of the whole input image.  It is only used if
+   * ComputeMaximumInputPixelIntensity is off.
+   */
+  itkSetMacro(MaximumInputPixelIntensity, RealType);
+  itkGetConstMacro(MaximumInputPixelIntensity, RealType);
+
+  /**
+   * Parameter sweep.  Each parameter set gives its own outputs, all computed
+   * in a single execution: the local statistics, the residuals, the search
+   * and the patch distances are shared, and only the preselection, the
+   * weighting and the Rician bias are repeated for every set.  A neighbor is
+   * searched if one of the sets preselects it, and each set then weighs the
+   * neighbors it preselects itself.  The outputs of each set are identical to
+   * those of a separate run with its parameters (the PatchMatch neighbors
+   * are still searched with the thresholds of the filter).  The output of
+   * channel c for set s is the output (s * number of channels + c), see
+   * GetSweepOutput().  Without a sweep the filter uses its own parameters.
+   * The sweep requires the DIRECT patch distance engine.  Default = empty.
+   */
+  void
+  SetSweepParameters(const SweepParametersListType &);
+  itkGetConstReferenceMacro(SweepParameters, SweepParametersListType);
+
+  /** Number of parameter sets: those of the sweep, or the filter's own. */
+  unsigned int
+  GetNumberOfParameterSets() const;
+
+  /** Output of a channel for a parameter set of the sweep. */
+  OutputImageType *
+  GetSweepOutput(unsigned int parameterSet, unsigned int channel = 0);
+
+  /**
+   * Generate the intermediate images of the input image as extra outputs,
+   * over the output requested region: its local mean and variance and, with
+   * the Rician noise model, its local noise level (the square root of the
+   * smoothed minimum patch distance, which divides the local mean into the
+   * signal-to-noise ratio of the correction) and the Rician bias subtracted
+   * from its squared estimate, for the first parameter set.  Voxels which the
+   * computation does not reach (e.g. away from the mask with the masked
+   * execution) are zero, and the noise level and bias are only meaningful
+   * inside the mask, if any.  Default = false.
+   */
+  itkSetMacro(ComputeIntermediateOutputs, bool);
+  itkGetConstMacro(ComputeIntermediateOutputs, bool);
+  itkBooleanMacro(ComputeIntermediateOutputs);
+
+  /** Local mean of the input image.  Only generated if ComputeIntermediateOutputs is on. */
+  RealImageType *
+  GetLocalMeanOutput()
+  {
+    return static_cast<RealImageType *>(this->ProcessObject::GetOutput("LocalMean"));
+  }
+
+  /** Local variance of the input image.  Only generated if ComputeIntermediateOutputs is on. */
+  RealImageType *
+  GetLocalVarianceOutput()
+  {
+    return static_cast<RealImageType *>(this->ProcessObject::GetOutput("LocalVariance"));
+  }
+
+  /** Local noise level of the input image.  Only generated if ComputeIntermediateOutputs is on. */
+  RealImageType *
+  GetNoiseSigmaOutput()
+  {
+    return static_cast<RealImageType *>(this->ProcessObject::GetOutput("NoiseSigma"));
+  }
+
+  /** Rician bias of the input image.  Only generated if ComputeIntermediateOutputs is on. */
+  RealImageType *
+  GetRicianBiasOutput()
+  {
+    return static_cast<RealImageType *>(this->ProcessObject::GetOutput("RicianBias"));
+  }
+
 protected:
   AdaptiveNonLocalMeansDenoisingImageFilter();
   ~AdaptiveNonLocalMeansDenoisingImageFilter() override = default;
@@ -179,8 +547,25 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** The intermediate outputs are images of real values. */
+  ProcessObject::DataObjectPointer
+  MakeOutput(const ProcessObject::DataObjectIdentifierType &) override;
+  using Superclass::MakeOutput;
+
+  /** The intermediate outputs are only allocated when they are generated. */
   void
-  ThreadedGenerateData(const RegionType &, ThreadIdType) override;
+  AllocateOutputs() override;
+
+  /**
+   * The input is requested over the output requested region padded by the
+   * reach of the centers contributing to it, their search neighborhoods and
+   * patches, and the local mean and variance neighborhood.
+   */
+  void
+  GenerateInputRequestedRegion() override;
+
+  void
+  GenerateData() override;
 
   void
   BeforeThreadedGenerateData() override;
@@ -189,11 +574,631 @@ protected:
   AfterThreadedGenerateData() override;
 
 private:
-  RealType CalculateCorrectionFactor(RealType);
+  /**
+   * Accumulation buffers owned by a single slab.  They cover the slab padded
+   * by the patch radius (cropped to the target region) so that no two slabs
+   * ever write to the same memory.  A negative bias marks voxels to which no
+   * center of the slab has written a Rician bias.  There is one estimate and
+   * one bias image per channel and parameter set, in the order of the outputs.
+   */
+  struct ChunkAccumulator
+  {
+    RegionType                    m_Region;
+    std::vector<RealImagePointer> m_EstimateImages;
+    std::vector<RealImagePointer> m_RicianBiasImages;
+  };
 
-  bool m_UseRicianNoiseModel;
+  /** Split the region of the centers into slabs along the slowest axis. */
+  std::vector<RegionType>
+  SplitCenterImageRegionIntoChunks() const;
 
-  ModifiedBesselCalculatorType m_ModifiedBesselCalculator;
+  /**
+   * Split a slab into the tiles visited one after the other by the tiled
+   * traversal, in raster order, or return the slab itself.
+   */
+  std::vector<RegionType>
+  SplitChunkRegionIntoTiles(const RegionType &) const;
+
+  /**
+   * Parameter sets of the execution: those of the sweep, or the filter's own
+   * parameters.
+   */
+  SweepParametersListType
+  GetParameterSets() const;
+
+  /** Make an output for every channel of every parameter set. */
+  void
+  UpdateNumberOfOutputs();
+
+  /**
+   * Radius of the kernel smoothing the Rician bias (zero for the Gaussian
+   * noise model), for the largest smoothing variance of the parameter sets.
+   * The recursive smoother reaches across the whole image.
+   */
+  NeighborhoodRadiusType
+  GetRicianBiasSmoothingRadius() const;
+
+  /**
+   * Region of the centers whose patches reach the output requested region,
+   * or the voxels of the Rician bias smoothed into it.
+   */
+  RegionType
+  ComputeCenterImageRegion() const;
+
+  /**
+   * Region of the mean, variance and residual images: the search
+   * neighborhoods and patches of the centers, or the whole image when the
+   * maximum intensity is computed.
+   */
+  RegionType
+  ComputeAuxiliaryImageRegion(const RegionType &) const;
+
+  /**
+   * A precomputed local statistics image laid out over the auxiliary region:
+   * the image itself if it is buffered over the region, or else a copy of it
+   * cropped to the region.
+   */
+  RealImagePointer
+  CropToAuxiliaryImageRegion(const RealImageType *, const RegionType &) const;
+
+  /**
+   * Copy an intermediate image into the buffered region of its output, where
+   * they overlap, and zero the rest of the output.
+   */
+  void
+  CopyToIntermediateOutput(const RealImageType *, RealImageType *) const;
+
+  /**
+   * Bounding box of the masked voxels of a region of the mask image, with a
+   * size of zero if there are none.
+   */
+  RegionType
+  ComputeMaskBoundingBox(const RegionType &) const;
+
+  /** Whether the masked execution applies (it is requested and there is a mask). */
+  bool
+  IsMaskedExecution() const;
+
+  /** Whether the voxel lies on the grid of centers defined by the center stride. */
+  bool
+  IsPatchCenter(const IndexType &) const;
+  bool
+  IsPatchCenterAlongAxis(const IndexValueType, const unsigned int) const;
+
+  /**
+   * Number of centers whose patch covers each voxel of the output requested
+   * region along the given axis.  The count of a voxel is the product of its
+   * counts along the axes.
+   */
+  std::vector<RealType>
+  ComputeContributionCounts(const unsigned int) const;
+
+  typedef Image<double, ImageDimension>        SummedAreaTableType;
+  typedef typename SummedAreaTableType::Pointer SummedAreaTablePointer;
+
+  /**
+   * Whether a search neighbor passes the mean and variance preselection, with
+   * the thresholds of the filter or of a parameter set.
+   */
+  bool
+  IsNeighborPreselected(const RealType, const RealType, const IndexType &) const;
+  bool
+  IsNeighborPreselected(const RealType,
+                        const RealType,
+                        const InputPixelType,
+                        const RealType,
+                        const RealType) const;
+  bool
+  IsNeighborPreselected(const RealType,
+                        const RealType,
+                        const InputPixelType,
+                        const RealType,
+                        const RealType,
+                        const SweepParameters &) const;
+
+  /** Denoise the centers of a single slab into its own accumulators. */
+  void
+  GenerateChunkData(const RegionType &, ChunkAccumulator &);
+
+  /**
+   * Call rowFunction(n, length, rowIndex1, rowIndex2) for every row (along
+   * the first axis) of the patches centered at the two indices, clipped so
+   * that both rows lie inside the target region.  n is the position in the
+   * patch offset list of the first voxel of the clipped row, and the row
+   * indices are those of that voxel in each patch.
+   */
+  template <typename TRowFunction>
+  void
+  VisitPatchRows(const IndexType &, const IndexType &, TRowFunction &&) const;
+
+  /** Half precision pixels (IEEE 754 binary16 bit patterns) and images. */
+  typedef uint16_t                        HalfType;
+  typedef Image<HalfType, ImageDimension> HalfImageType;
+  typedef typename HalfImageType::Pointer HalfImagePointer;
+
+  /**
+   * The auxiliary images read by the DIRECT engine, with the pixel type of
+   * their storage precision (RealType or HalfType), and the scales which
+   * turn their expanded pixels back into the original values.  There is a
+   * residual image for every channel whose distances are computed, all with
+   * the buffered region of the mean and variance images.
+   */
+  template <typename TAuxiliaryPixel>
+  struct AuxiliaryImages
+  {
+    typedef Image<TAuxiliaryPixel, ImageDimension> ImageType;
+
+    const ImageType *              m_MeanImage;
+    const ImageType *              m_VarianceImage;
+    std::vector<const ImageType *> m_ResidualImages;
+    RealType                       m_MeanScale;
+    RealType                       m_VarianceScale;
+    std::vector<RealType>          m_ResidualScales;
+  };
+  void
+  GetAuxiliaryImages(AuxiliaryImages<RealType> &) const;
+  void
+  GetAuxiliaryImages(AuxiliaryImages<HalfType> &) const;
+
+  /**
+   * Conversions between RealType and half precision, rounding to nearest
+   * even.  Subnormal half precision values are supported, infinities and
+   * NaNs are not.  Both are branch free so that the loops over the pixels
+   * vectorize.
+   */
+  static HalfType
+  ConvertToHalf(const RealType);
+  static RealType
+  ConvertToReal(const HalfType);
+  static RealType
+  ConvertToReal(const RealType value)
+  {
+    return value;
+  }
+
+  /**
+   * Half precision copy of an auxiliary image, scaled by the power of two
+   * returned in the second argument which brings its largest magnitude
+   * between 2^14 and 2^15.
+   */
+  HalfImagePointer
+  ConvertToHalfImage(const RealImageType *, RealType &) const;
+
+  /** RealType copy of a half precision image with the given scale. */
+  RealImagePointer
+  ConvertToRealImage(const HalfImageType *, const RealType) const;
+
+  /** Input, mean and variance of a search neighbor, as read by the preselection. */
+  struct NeighborStatistics
+  {
+    InputPixelType m_Input;
+    RealType       m_Mean;
+    RealType       m_Variance;
+  };
+
+  /**
+   * State of a slab denoised by the DIRECT engine, shared by the helpers of
+   * GenerateChunkDataWithDirectDistances().  A non-zero VPatchRadius is the
+   * (isotropic) patch radius, fixed at compile time, and TAuxiliaryPixel the
+   * pixel type of the auxiliary images.  The weighted intensities may point
+   * into the structure itself, which is therefore never copied.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  struct DirectDistanceChunk
+  {
+    typedef typename AuxiliaryImages<TAuxiliaryPixel>::ImageType AuxiliaryImageType;
+
+    static constexpr SizeValueType FixedRowLength = VPatchRadius > 0 ? 2 * VPatchRadius + 1 : 0;
+    static constexpr SizeValueType FixedPatchSize =
+      VPatchRadius > 0 ? Math::UnsignedPower(FixedRowLength, ImageDimension) : 0;
+
+    DirectDistanceChunk() = default;
+    DirectDistanceChunk(const DirectDistanceChunk &) = delete;
+    DirectDistanceChunk &
+    operator=(const DirectDistanceChunk &) = delete;
+
+    // The slab, its accumulators and the images read.
+    RegionType                 m_Region;
+    ChunkAccumulator *         m_Accumulator;
+    const InputImageType *     m_InputImage;
+    const MaskImageType *      m_MaskImage;
+    const AuxiliaryImageType * m_MeanImage;
+    const AuxiliaryImageType * m_VarianceImage;
+    const AuxiliaryImageType * m_ResidualImage;
+    RealType                   m_MeanScale;
+    RealType                   m_VarianceScale;
+    RealType                   m_ResidualScale;
+    RegionType                 m_TargetImageRegion;
+    RegionType                 m_SearchImageRegion;
+
+    // The patch rows, and their buffer offsets from the center of a patch.
+    SizeValueType                             m_RowLength;
+    SizeValueType                             m_NeighborhoodPatchSize;
+    SizeValueType                             m_NumberOfRows;
+    std::vector<OffsetValueType>              m_ResidualRowOffsets;
+    std::vector<OffsetValueType>              m_AccumulatorRowOffsets;
+    std::vector<std::vector<OffsetValueType>> m_ChannelRowOffsets;
+
+    // The buffers of the channels, of the outputs and of the channels whose
+    // distances are computed.
+    const InputPixelType *               m_InputBuffer;
+    const TAuxiliaryPixel *              m_MeanBuffer;
+    const TAuxiliaryPixel *              m_VarianceBuffer;
+    unsigned int                         m_NumberOfChannels;
+    unsigned int                         m_NumberOfBiasChannels;
+    unsigned int                         m_NumberOfDistanceChannels;
+    SweepParametersListType              m_ParameterSets;
+    unsigned int                         m_NumberOfParameterSets;
+    unsigned int                         m_NumberOfOutputs;
+    std::vector<const InputImageType *>  m_ChannelImages;
+    std::vector<const InputPixelType *>  m_ChannelBuffers;
+    std::vector<RealType *>              m_EstimateBuffers;
+    std::vector<const TAuxiliaryPixel *> m_ResidualBuffers;
+    std::vector<RealType>                m_SquaredResidualScales;
+    std::vector<RealType *>              m_RicianBiasBuffers;
+    bool                                 m_UsePearsonCorrelation;
+    const RealType *                     m_PatchMeanBuffer;
+    const RealType *                     m_PatchInverseStandardDeviationBuffer;
+
+    // The search offsets, which PatchMatch replaces for every center, and
+    // their buffer offsets.  The centers of the interior region need no
+    // bounds checking.
+    bool                                      m_UsePatchMatch;
+    NeighborhoodRadiusType                    m_NeighborhoodSearchExtent;
+    NeighborhoodOffsetListType                m_NeighborhoodSearchOffsetList;
+    unsigned int                              m_NeighborhoodSearchSize;
+    unsigned int                              m_CenterSearchOffset;
+    RegionType                                m_InteriorRegion;
+    RegionType                                m_PatchInteriorRegion;
+    SizeValueType                             m_NumberOfPatchMatchNeighbors;
+    std::vector<OffsetValueType>              m_InputSearchOffsets;
+    std::vector<OffsetValueType>              m_MeanSearchOffsets;
+    std::vector<OffsetValueType>              m_VarianceSearchOffsets;
+    std::vector<OffsetValueType>              m_ResidualSearchOffsets;
+    std::vector<std::vector<OffsetValueType>> m_ChannelSearchOffsets;
+
+    // Positions in the search offset list of the neighbors searched from the
+    // current center, and the coarse-to-fine candidates of the cells.
+    std::vector<unsigned int> m_SearchOffsets;
+    std::vector<unsigned int> m_CellCandidates;
+    RegionType                m_CellRegion;
+    IndexType                 m_SearchOffsetsCellIndex;
+    bool                      m_HasSearchOffsetsCell;
+    std::vector<bool>         m_IsSearchOffset;
+
+    // The traversed region (the slab or the current tile), its ring buffer of
+    // symmetric distances and its tile statistics.
+    std::vector<RegionType>         m_TileRegions;
+    RegionType                      m_TraversalRegion;
+    SizeValueType                   m_CenterPosition;
+    bool                            m_UseSymmetricDistances;
+    std::vector<unsigned int>       m_OppositeSearchOffsets;
+    std::vector<unsigned int>       m_SymmetricEntries;
+    std::vector<bool>               m_IsForwardSearchOffset;
+    std::vector<SizeValueType>      m_ForwardRasterSteps;
+    unsigned int                    m_NumberOfSymmetricEntries;
+    SizeValueType                   m_NumberOfSymmetricSlots;
+    std::vector<RealType>           m_SymmetricDistances;
+    bool                            m_UseTileStatistics;
+    RegionType                      m_TileStatisticsRegion;
+    std::vector<NeighborStatistics> m_TileStatistics;
+    std::vector<OffsetValueType>    m_TileStatisticsSearchOffsets;
+    std::vector<SizeValueType>      m_RicianBiasPositions;
+
+    // The current center.
+    IndexType                    m_CenterIndex;
+    bool                         m_IsInteriorCenter;
+    OffsetValueType              m_InputCenterOffset;
+    OffsetValueType              m_MeanCenterOffset;
+    OffsetValueType              m_VarianceCenterOffset;
+    OffsetValueType              m_ResidualCenterOffset;
+    OffsetValueType              m_AccumulatorCenterOffset;
+    std::vector<OffsetValueType> m_ChannelCenterOffsets;
+    OffsetValueType              m_TileStatisticsCenterOffset;
+    InputPixelType               m_InputCenterPixel;
+    RealType                     m_MeanCenterPixel;
+    RealType                     m_VarianceCenterPixel;
+
+    // The weighting of the current center: the weighted intensities of the
+    // channels, one patch after the other in the order of the outputs, the
+    // minimum distances of every parameter set for every channel, the
+    // weighting state of every parameter set, and the preselected neighbors
+    // with the sets which preselect them.
+    std::array<RealType, (FixedPatchSize > 0 ? FixedPatchSize : 1)> m_FixedWeightedAverageIntensities;
+    std::vector<RealType>                                           m_DynamicWeightedAverageIntensities;
+    RealType *                                                      m_WeightedAverageIntensities;
+    std::vector<RealType>                                           m_MinimumDistances;
+    std::vector<RealType>                                           m_CutoffDistances;
+    std::vector<RealType>                                           m_MaxWeights;
+    std::vector<RealType>                                           m_SumsOfWeights;
+    std::vector<unsigned int>                                       m_CandidateSearchOffsets;
+    std::vector<bool>                                               m_CandidatePreselections;
+    std::vector<bool>                                               m_IsPreselectedBySet;
+  };
+
+  /**
+   * GenerateChunkData() for the DIRECT patch distance engine.  It visits the
+   * voxels of the slab, tile by tile, and runs the helpers below for each
+   * center.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  GenerateChunkDataWithDirectDistances(const RegionType &, ChunkAccumulator &);
+
+  /** Set up the state of the slab, before its first center. */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  InitializeDirectDistanceChunk(const RegionType &,
+                                ChunkAccumulator &,
+                                DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Symmetric patch distances.  The search offsets are matched with their
+   * opposites, and of each pair the forward offset points further along in
+   * raster order.  The distance from a center along a forward offset is
+   * stored for the neighbor, which reads it back along the backward offset
+   * when it becomes the center.  Each voxel of the traversed region has a
+   * slot of a ring buffer, with one entry per pair.  The ring buffer is set up
+   * for each traversed region, and the slot of the voxel before the current
+   * one is recycled once every voxel that may store into it has been visited.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  SetUpSymmetricPatchDistances(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  RecycleSymmetricPatchDistanceSlot(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Gather the input, mean and variance of the traversed region and of its
+   * search halo into one interleaved buffer for the preselection (tiled
+   * traversal without PatchMatch only).
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  GatherTileStatistics(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Make the voxel the current center: compute its buffer offsets and
+   * statistics, and clear its weighting state.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  SetUpDirectDistanceCenter(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &, const IndexType &) const;
+
+  /**
+   * Search the neighbors refined from the best coarse offsets of the given
+   * cell, in list order (coarse-to-fine search only).
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  SelectCellSearchOffsets(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &, const IndexType &) const;
+
+  /**
+   * Search the PatchMatch neighbors of the current center, followed by the
+   * zero offset.  The center only stays interior if the patches of all its
+   * neighbors are too.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  SelectPatchMatchNeighbors(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Gather the searched neighbors of the current center which pass the
+   * preselection of at least one parameter set, and compute the minimum
+   * distances of every parameter set, in every channel for the Rician bias.
+   * A minimum distance of zero is replaced by one.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  ComputeMinimumDistances(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Store the minimum distances of the current center as the Rician biases of
+   * its patch.  With tiles, a voxel only takes the bias of a center further
+   * along in raster order, as it would have without tiles.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  StoreRicianBiases(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Weight the preselected neighbors of the current center and accumulate
+   * their weighted intensities.  The maximum weight of a parameter set which
+   * weighted no neighbor is one.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  WeightNeighbors(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Weight the center itself with the maximum weight and add the weighted
+   * average of its patch to the estimates.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  AccumulateCenterEstimates(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &) const;
+
+  /**
+   * Average squared distance between the residual patches of the m-th
+   * neighbor and of the current center, or their correlation dissimilarity
+   * with PEARSON_CORRELATION, read back or stored for the neighbor with the
+   * symmetric patch distances.  Returns false, without a distance, if the
+   * squared distance exceeds the given bound on the sum of a whole patch.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  bool
+  ComputeAverageDistance(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &,
+                         const unsigned int,
+                         const RealType,
+                         RealType &) const;
+
+  /**
+   * Patch kernels of the current center, for the m-th neighbor: the squared
+   * norm of its residual patch in the given channel, the squared distance
+   * between its residual patch and that of the center, which stops early and
+   * returns false once the partial sum exceeds the given bound, and the sum
+   * of the products of their centered residuals.  Each returns its sum and
+   * the number of voxels summed, fewer than the patch size if the patches are
+   * clipped to the target region.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  ComputeSquaredNorm(const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &,
+                     const unsigned int,
+                     const unsigned int,
+                     RealType &,
+                     RealType &) const;
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  bool
+  ComputeSquaredDistance(const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &,
+                         const unsigned int,
+                         const RealType,
+                         RealType &,
+                         RealType &) const;
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  ComputeCenteredProducts(const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &,
+                          const unsigned int,
+                          RealType &,
+                          RealType &) const;
+
+  /**
+   * Add the weighted intensities of the patch of the m-th neighbor, in every
+   * channel, to those of the given parameter set.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+  void
+  AccumulateWeightedIntensities(DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &,
+                                const unsigned int,
+                                const unsigned int,
+                                const RealType) const;
+
+  /**
+   * Call rowFunction(n, length, accumulatorOffset) for the rows of the patch
+   * of the current center in the accumulation buffers.
+   */
+  template <unsigned int VPatchRadius, typename TAuxiliaryPixel, typename TRowFunction>
+  void
+  VisitCenterPatchRows(const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> &, TRowFunction &&) const;
+
+  /**
+   * Contiguous row kernels.  Each row is summed on its own and the callers add
+   * the row sums in row order.  The independent row sums can overlap in the
+   * pipeline, and the order of the operations does not depend on the
+   * instruction set.  A non-zero VLength is the row length, fixed at compile
+   * time.  The residuals are expanded to RealType as they are read.
+   */
+  template <SizeValueType VLength, typename TPixel>
+  static RealType
+  SumOfSquares(const TPixel *, const SizeValueType);
+  template <SizeValueType VLength, typename TPixel>
+  static RealType
+  SumOfSquaredDifferences(const TPixel *, const TPixel *, const SizeValueType);
+  template <SizeValueType VLength, typename TPixel>
+  static RealType
+  SumOfCenteredProducts(const TPixel *, const RealType, const TPixel *, const RealType, const SizeValueType);
+  template <SizeValueType VLength>
+  static void
+  AccumulateWeightedRow(RealType *, const InputPixelType *, const SizeValueType, const RealType, const bool);
+
+  /** Linear buffer displacements of the given offsets in the image. */
+  template <typename TImage>
+  static std::vector<OffsetValueType>
+  ComputeBufferOffsets(const TImage *, const NeighborhoodOffsetListType &);
+
+  /** Position of the zero offset in the search offset list. */
+  static unsigned int
+  FindCenterSearchOffset(const NeighborhoodOffsetListType &);
+
+  /**
+   * Radius of the coarse search neighborhood, in cells, which covers the
+   * search offsets once halved.
+   */
+  NeighborhoodRadiusType
+  GetCoarseSearchRadius() const;
+
+  /** Cell of the coarse-to-fine preselection which holds the voxel. */
+  IndexType
+  ComputeCellIndex(const IndexType &) const;
+
+  /**
+   * Coarse search for the cells which hold centers of the region.  Returns
+   * the region of these cells and, for each of them in raster order, the
+   * positions in the coarse offset list of its best coarse offsets, padded
+   * with NumericTraits<unsigned int>::max().
+   */
+  RegionType
+  ComputeCoarseSearchCandidates(const RegionType &, std::vector<unsigned int> &) const;
+
+  /** Raster position of the index in the region, and its inverse. */
+  static SizeValueType
+  ComputeRegionPosition(const RegionType &, const IndexType &);
+  static IndexType
+  ComputeRegionIndex(const RegionType &, const SizeValueType);
+
+  /** Bit mixing function of the counter-based PatchMatch random numbers. */
+  static uint64_t
+  MixBits(const uint64_t);
+
+  /** Distance between the residual patches of two voxels, for the similarity metric. */
+  RealType
+  ComputePatchDistance(const IndexType &, const IndexType &) const;
+
+  /**
+   * Mean and inverse standard deviation of the residual patch of every voxel
+   * of the residual image whose patch it holds (PEARSON_CORRELATION only).
+   */
+  void
+  ComputePatchStatistics();
+
+  /**
+   * One minus the correlation of two residual patches, from the average
+   * product of their centered residuals and their inverse standard
+   * deviations.  It is symmetric in the two patches, and clamped to [0, 2].
+   */
+  static RealType
+  ComputeCorrelationDissimilarity(const RealType, const RealType, const RealType);
+
+  /**
+   * PatchMatch search of the most similar voxels of those which the centers
+   * may draw on, stored by position in the target region.
+   */
+  void
+  ComputePatchMatchNeighbors();
+
+  /** GenerateChunkData() for the SUMMED_AREA_TABLE patch distance engine. */
+  void
+  GenerateChunkDataWithSummedAreaTables(const RegionType &, ChunkAccumulator &);
+
+  /**
+   * Allocate a summed-area table over the given region.  The table has one
+   * extra leading row of zeros along each axis so that box sums need no
+   * boundary tests.
+   */
+  SummedAreaTablePointer
+  AllocateSummedAreaTable(const RegionType &) const;
+
+  /** Turn the values stored in the table into their running sums. */
+  void
+  IntegrateSummedAreaTable(SummedAreaTableType *) const;
+
+  /** Sum of the original values over a (non-empty) sub-region of the table. */
+  double
+  SumOverRegion(const SummedAreaTableType *, const RegionType &) const;
+
+  /**
+   * Merge the accumulator of a slab into the shared images.  The slabs must
+   * be merged one at a time, in slab order.
+   */
+  void
+  MergeChunkAccumulator(const ChunkAccumulator &);
+
+  /** Correction factor of the Rician bias, interpolated from a table. */
+  RealType
+  CalculateCorrectionFactor(RealType) const;
+
+  bool m_UseRicianNoiseModel;
 
   RealType m_Epsilon;
   RealType m_MeanThreshold;
@@ -201,16 +1206,77 @@ private:
   RealType m_SmoothingFactor;
   RealType m_SmoothingVariance;
 
+  RicianBiasSmootherEnum m_RicianBiasSmoother;
+
   RealType m_MaximumInputPixelIntensity;
   RealType m_MinimumInputPixelIntensity;
 
   RealImagePointer m_MeanImage;
-  RealImagePointer m_RicianBiasImage;
   RealImagePointer m_VarianceImage;
-  RealImagePointer m_ThreadContributionCountImage;
-  RealImagePointer m_IntensitySquaredDistanceImage;
+  RealImagePointer m_ResidualImage;
+
+  // Mean and inverse standard deviation of the residual patch of every voxel,
+  // over the buffered region of the residual image (PEARSON_CORRELATION only).
+  RealImagePointer m_PatchMeanImage;
+  RealImagePointer m_PatchInverseStandardDeviationImage;
+
+  // Local mean and residual images of every channel (Rician noise model only,
+  // the first entries are those of the input image) and their Rician biases.
+  std::vector<RealImagePointer> m_ChannelMeanImages;
+  std::vector<RealImagePointer> m_ChannelResidualImages;
+  std::vector<RealImagePointer> m_RicianBiasImages;
 
   NeighborhoodRadiusType m_NeighborhoodRadiusForLocalMeanAndVariance;
+
+  CenterStrideType m_CenterStride;
+
+  PatchDistanceEngineEnum m_PatchDistanceEngine;
+
+  bool m_UsePatchDistanceEarlyTermination;
+  bool m_UseSymmetricPatchDistances;
+
+  bool         m_UseCoarseToFineSearch;
+  unsigned int m_NumberOfCoarseSearchCandidates;
+  unsigned int m_CoarseSearchRefinementRadius;
+
+  // Offsets of the coarse search and, for each of them, the positions in the
+  // search offset list of the offsets refined from it.
+  NeighborhoodOffsetListType             m_CoarseSearchOffsetList;
+  std::vector<std::vector<unsigned int>> m_CoarseToFineSearchOffsets;
+
+  // Region of the voxels searched by PatchMatch and, for each of them in
+  // raster order, the positions in the target region of its neighbors, padded
+  // with NumericTraits<SizeValueType>::max().
+  RegionType                 m_PatchMatchRegion;
+  std::vector<SizeValueType> m_PatchMatchNeighbors;
+
+  bool m_ComputeMaximumInputPixelIntensity;
+
+  RegionType m_CenterImageRegion;
+
+  // Masked execution, and the bounding box of the masked voxels of the mask
+  // buffered region which it then crops the work to.
+  bool       m_UseMaskedExecution;
+  RegionType m_MaskBoundingBox;
+
+  bool          m_UseTiledTraversal;
+  SizeValueType m_TileCacheSize;
+
+  SweepParametersListType m_SweepParameters;
+
+  bool m_ComputeIntermediateOutputs;
+
+  // With HALF precision, the local mean and variance images of the input
+  // image and the residual images of the channels whose distances are
+  // computed, which replace the RealType images during the search, and their
+  // scales.
+  AuxiliaryImagePrecisionEnum   m_AuxiliaryImagePrecision;
+  HalfImagePointer              m_HalfMeanImage;
+  HalfImagePointer              m_HalfVarianceImage;
+  std::vector<HalfImagePointer> m_HalfResidualImages;
+  RealType                      m_HalfMeanScale;
+  RealType                      m_HalfVarianceScale;
+  std::vector<RealType>         m_HalfResidualScales;
 };
 
 } // end namespace itk
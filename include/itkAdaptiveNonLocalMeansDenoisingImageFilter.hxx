@@ -19,18 +19,25 @@
 #define itkAdaptiveNonLocalMeansDenoisingImageFilter_hxx
 
 
-#include "itkArray.h"
 #include "itkDiscreteGaussianImageFilter.h"
+#include "itkGaussianOperator.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionIteratorWithIndex.h"
+#include "itkLocalMeanAndVarianceImageFilter.h"
 #include "itkMath.h"
-#include "itkMeanImageFilter.h"
 #include "itkNeighborhoodIterator.h"
-#include "itkProgressReporter.h"
-#include "itkStatisticsImageFilter.h"
-#include "itkVarianceImageFilter.h"
+#include "itkRicianNoiseCorrectionFactor.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkTotalProgressReporter.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
 #include <numeric>
 
 namespace itk
@@ -45,6 +52,7 @@ AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>
   , m_VarianceThreshold(0.5)
   , m_SmoothingFactor(1.0)
   , m_SmoothingVariance(2.0)
+  , m_RicianBiasSmoother(RicianBiasSmootherEnum::DISCRETE_GAUSSIAN)
   , m_MaximumInputPixelIntensity(NumericTraits<RealType>::NonpositiveMin())
   , m_MinimumInputPixelIntensity(NumericTraits<RealType>::max())
 {
@@ -52,445 +60,4028 @@ AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>
 
   this->m_MeanImage = nullptr;
   this->m_VarianceImage = nullptr;
-  this->m_IntensitySquaredDistanceImage = nullptr;
-  this->m_ThreadContributionCountImage = nullptr;
+  this->m_ResidualImage = nullptr;
+  this->m_PatchMeanImage = nullptr;
+  this->m_PatchInverseStandardDeviationImage = nullptr;
 
-  this->m_RicianBiasImage = nullptr;
+  this->m_NeighborhoodRadiusForLocalMeanAndVariance.Fill(1);
+  this->m_CenterStride.Fill(1);
+
+  this->m_PatchDistanceEngine = PatchDistanceEngineEnum::DIRECT;
+  this->m_UsePatchDistanceEarlyTermination = true;
+  this->m_UseSymmetricPatchDistances = false;
+
+  this->m_UseCoarseToFineSearch = false;
+  this->m_NumberOfCoarseSearchCandidates = 8;
+  this->m_CoarseSearchRefinementRadius = 1;
+
+  this->m_ComputeMaximumInputPixelIntensity = true;
+
+  this->m_UseMaskedExecution = false;
+
+  this->m_UseTiledTraversal = false;
+  this->m_TileCacheSize = 262144;
+
+  this->m_AuxiliaryImagePrecision = AuxiliaryImagePrecisionEnum::SINGLE;
+  this->m_HalfMeanScale = NumericTraits<RealType>::OneValue();
+  this->m_HalfVarianceScale = NumericTraits<RealType>::OneValue();
+
+  // The intermediate outputs are named, apart from the outputs of the channels
+  // and parameter sets.
+  this->m_ComputeIntermediateOutputs = false;
+  this->SetOutput("LocalMean", this->MakeOutput("LocalMean"));
+  this->SetOutput("LocalVariance", this->MakeOutput("LocalVariance"));
+  this->SetOutput("NoiseSigma", this->MakeOutput("NoiseSigma"));
+  this->SetOutput("RicianBias", this->MakeOutput("RicianBias"));
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+ProcessObject::DataObjectPointer
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::MakeOutput(
+  const ProcessObject::DataObjectIdentifierType & name)
+{
+  if (name == "LocalMean" || name == "LocalVariance" || name == "NoiseSigma" || name == "RicianBias")
+  {
+    return RealImageType::New().GetPointer();
+  }
+  return Superclass::MakeOutput(name);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::AllocateOutputs()
+{
+  for (unsigned int i = 0; i < this->GetNumberOfIndexedOutputs(); i++)
+  {
+    OutputImageType * outputImage = this->GetOutput(i);
+    outputImage->SetBufferedRegion(outputImage->GetRequestedRegion());
+    outputImage->Allocate();
+  }
+
+  if (!this->m_ComputeIntermediateOutputs)
+  {
+    return;
+  }
+  for (RealImageType * intermediateImage : { this->GetLocalMeanOutput(),
+                                             this->GetLocalVarianceOutput(),
+                                             this->GetNoiseSigmaOutput(),
+                                             this->GetRicianBiasOutput() })
+  {
+    intermediateImage->SetBufferedRegion(intermediateImage->GetRequestedRegion());
+    intermediateImage->Allocate();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SetChannel(
+  unsigned int           channel,
+  const InputImageType * image)
+{
+  if (channel == 0)
+  {
+    this->SetInput(image);
+    return;
+  }
+
+  // The mask takes the second input, so channel i is the (i + 1)-th input.
+  this->SetNthInput(channel + 1, const_cast<InputImageType *>(image));
+
+  this->UpdateNumberOfOutputs();
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetChannel(
+  unsigned int channel) const -> const InputImageType *
+{
+  if (channel == 0)
+  {
+    return this->GetInput();
+  }
+  return static_cast<const InputImageType *>(this->ProcessObject::GetInput(channel + 1));
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+unsigned int
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetNumberOfChannels() const
+{
+  const unsigned int numberOfIndexedInputs = static_cast<unsigned int>(this->GetNumberOfIndexedInputs());
+  return numberOfIndexedInputs > 2 ? numberOfIndexedInputs - 1 : 1;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SetSweepParameters(
+  const SweepParametersListType & sweepParameters)
+{
+  this->m_SweepParameters = sweepParameters;
+  this->UpdateNumberOfOutputs();
+  this->Modified();
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+unsigned int
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetNumberOfParameterSets() const
+{
+  return std::max(static_cast<unsigned int>(this->m_SweepParameters.size()), 1u);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetSweepOutput(
+  unsigned int parameterSet,
+  unsigned int channel) -> OutputImageType *
+{
+  return this->GetOutput(parameterSet * this->GetNumberOfChannels() + channel);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetParameterSets() const
+  -> SweepParametersListType
+{
+  if (!this->m_SweepParameters.empty())
+  {
+    return this->m_SweepParameters;
+  }
+
+  SweepParameters parameters;
+  parameters.m_SmoothingFactor = this->m_SmoothingFactor;
+  parameters.m_MeanThreshold = this->m_MeanThreshold;
+  parameters.m_VarianceThreshold = this->m_VarianceThreshold;
+  parameters.m_SmoothingVariance = this->m_SmoothingVariance;
+  return SweepParametersListType(1, parameters);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::UpdateNumberOfOutputs()
+{
+  const unsigned int numberOfOutputs = this->GetNumberOfParameterSets() * this->GetNumberOfChannels();
+  for (unsigned int i = static_cast<unsigned int>(this->GetNumberOfIndexedOutputs()); i < numberOfOutputs; i++)
+  {
+    this->SetNthOutput(i, this->MakeOutput(i));
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * inputImage = const_cast<InputImageType *>(this->GetInput());
+  auto * maskImage = const_cast<MaskImageType *>(this->GetMaskImage());
+  if (!inputImage)
+  {
+    return;
+  }
+
+  const RegionType centerImageRegion = this->ComputeCenterImageRegion();
+  const RegionType auxiliaryRegion = this->ComputeAuxiliaryImageRegion(centerImageRegion);
+
+  if (maskImage)
+  {
+    RegionType maskRequestedRegion = centerImageRegion;
+    maskRequestedRegion.Crop(maskImage->GetLargestPossibleRegion());
+    maskImage->SetRequestedRegion(maskRequestedRegion);
+  }
+
+  // The precomputed local statistics are read over the auxiliary region.
+  bool hasLocalStatistics = true;
+  for (const RealImageType * localStatisticsImage : { this->GetLocalMeanImage(), this->GetLocalVarianceImage() })
+  {
+    if (!localStatisticsImage)
+    {
+      hasLocalStatistics = false;
+      continue;
+    }
+    if (localStatisticsImage->GetLargestPossibleRegion() != inputImage->GetLargestPossibleRegion())
+    {
+      itkExceptionMacro("The largest possible region of the local statistics image ("
+                        << localStatisticsImage->GetLargestPossibleRegion()
+                        << ") differs from that of the input image.");
+    }
+    const_cast<RealImageType *>(localStatisticsImage)->SetRequestedRegion(auxiliaryRegion);
+  }
+
+  RegionType localStatisticsRequestedRegion = inputImage->GetLargestPossibleRegion();
+  if (!this->m_ComputeMaximumInputPixelIntensity)
+  {
+    typedef LocalMeanAndVarianceImageFilter<InputImageType, RealImageType> LocalStatisticsFilterType;
+    typename LocalStatisticsFilterType::Pointer localStatisticsFilter = LocalStatisticsFilterType::New();
+    localStatisticsFilter->SetRadius(this->GetNeighborhoodRadiusForLocalMeanAndVariance());
+
+    localStatisticsRequestedRegion =
+      localStatisticsFilter->ComputeInputRequestedRegion(auxiliaryRegion, inputImage->GetLargestPossibleRegion());
+  }
+
+  // When its local statistics are given, the input image is only read over
+  // the auxiliary region, unless its intensity range is computed.
+  if (hasLocalStatistics && !this->m_ComputeMaximumInputPixelIntensity)
+  {
+    inputImage->SetRequestedRegion(auxiliaryRegion);
+  }
+  else
+  {
+    inputImage->SetRequestedRegion(localStatisticsRequestedRegion);
+  }
+
+  // The channels are read wherever their own local statistics need.
+  for (unsigned int c = 1; c < this->GetNumberOfChannels(); c++)
+  {
+    auto * channelImage = const_cast<InputImageType *>(this->GetChannel(c));
+    if (!channelImage)
+    {
+      continue;
+    }
+    if (channelImage->GetLargestPossibleRegion() != inputImage->GetLargestPossibleRegion())
+    {
+      itkExceptionMacro("The largest possible region of channel " << c << " ("
+                                                                   << channelImage->GetLargestPossibleRegion()
+                                                                   << ") differs from that of the input image.");
+    }
+    channelImage->SetRequestedRegion(localStatisticsRequestedRegion);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GenerateData()
+{
+  this->BeforeThreadedGenerateData();
+
+  const std::vector<RegionType> chunkRegions = this->SplitCenterImageRegionIntoChunks();
+  const SizeValueType           numberOfChunks = chunkRegions.size();
+
+  std::vector<ChunkAccumulator> chunkAccumulators(numberOfChunks);
+
+  // A slab is merged into the shared images, and its buffers released, as
+  // soon as it and all the slabs before it are done.  The merges are thus
+  // made one at a time in slab order, which keeps the result independent of
+  // the scheduling, while the other work units carry on with their slabs.
+  std::vector<bool> isChunkDone(numberOfChunks, false);
+  SizeValueType     nextChunkToMerge = 0;
+  bool              isMerging = false;
+  std::mutex        mergeMutex;
+
+  // Slabs differ widely in cost (masked and background slabs finish almost
+  // immediately) so, rather than receiving a fixed share of the slabs, each
+  // work unit keeps pulling the next unprocessed slab until none are left.
+  const SizeValueType numberOfWorkUnits =
+    std::min(static_cast<SizeValueType>(this->GetNumberOfWorkUnits()), numberOfChunks);
+
+  std::atomic<SizeValueType> nextChunk(0);
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits(numberOfWorkUnits);
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    numberOfWorkUnits,
+    [&](SizeValueType) {
+      for (SizeValueType c = nextChunk++; c < numberOfChunks; c = nextChunk++)
+      {
+        this->GenerateChunkData(chunkRegions[c], chunkAccumulators[c]);
+
+        std::unique_lock<std::mutex> lock(mergeMutex);
+        isChunkDone[c] = true;
+        if (isMerging)
+        {
+          continue;
+        }
+
+        // The work unit which completes the next slab to merge takes over
+        // the merges until it reaches a slab which is not done yet.
+        isMerging = true;
+        while (nextChunkToMerge < numberOfChunks && isChunkDone[nextChunkToMerge])
+        {
+          ChunkAccumulator & accumulator = chunkAccumulators[nextChunkToMerge];
+          lock.unlock();
+          this->MergeChunkAccumulator(accumulator);
+          accumulator = ChunkAccumulator();
+          lock.lock();
+          nextChunkToMerge++;
+        }
+        isMerging = false;
+      }
+    },
+    nullptr);
+
+  this->AfterThreadedGenerateData();
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SplitCenterImageRegionIntoChunks()
+  const -> std::vector<RegionType>
+{
+  // The partition is anchored to the target region and only depends on it so
+  // that the order of the merges, and hence the result, depends
+  // neither on the number of threads nor on the streamed piece.
+  constexpr SizeValueType maximumNumberOfChunks = 64;
+
+  const RegionType &  targetImageRegion = this->m_TargetImageRegion;
+  const unsigned int  splitAxis = ImageDimension - 1;
+  const SizeValueType splitAxisSize = targetImageRegion.GetSize(splitAxis);
+
+  std::vector<RegionType> chunkRegions;
+  if (splitAxisSize == 0)
+  {
+    return chunkRegions;
+  }
+
+  const SizeValueType numberOfChunks = std::min(maximumNumberOfChunks, splitAxisSize);
+  const SizeValueType chunkThickness = (splitAxisSize + numberOfChunks - 1) / numberOfChunks;
+
+  // With the masked execution, every slab only keeps the centers whose patch
+  // may overlap one of the masked voxels near the slab.  The other centers are
+  // not searched and only spread voxels which keep their input intensity.
+  const bool                   isMaskedExecution = this->IsMaskedExecution();
+  const NeighborhoodRadiusType neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+
+  for (SizeValueType offset = 0; offset < splitAxisSize; offset += chunkThickness)
+  {
+    RegionType chunkRegion = this->m_CenterImageRegion;
+    chunkRegion.SetIndex(splitAxis, targetImageRegion.GetIndex(splitAxis) + static_cast<IndexValueType>(offset));
+    chunkRegion.SetSize(splitAxis, std::min(chunkThickness, splitAxisSize - offset));
+    if (this->m_CenterImageRegion.GetNumberOfPixels() == 0 || !chunkRegion.Crop(this->m_CenterImageRegion))
+    {
+      continue;
+    }
+    if (isMaskedExecution)
+    {
+      RegionType maskRegion = chunkRegion;
+      maskRegion.PadByRadius(neighborhoodPatchRadius);
+
+      RegionType maskBoundingBox = this->ComputeMaskBoundingBox(maskRegion);
+      if (maskBoundingBox.GetNumberOfPixels() == 0)
+      {
+        continue;
+      }
+      maskBoundingBox.PadByRadius(neighborhoodPatchRadius);
+      if (!chunkRegion.Crop(maskBoundingBox))
+      {
+        continue;
+      }
+    }
+    chunkRegions.push_back(chunkRegion);
+  }
+  return chunkRegions;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SplitChunkRegionIntoTiles(
+  const RegionType & chunkRegion) const -> std::vector<RegionType>
+{
+  if (!this->m_UseTiledTraversal || this->m_PatchDistanceEngine != PatchDistanceEngineEnum::DIRECT ||
+      chunkRegion.GetNumberOfPixels() == 0)
+  {
+    return std::vector<RegionType>(1, chunkRegion);
+  }
+
+  // The footprint of a tile is the tile padded by the search extent and the
+  // patch radius, with the input, mean, variance and residual of each voxel,
+  // the last three at their storage precision.
+  // The tiles share the same edge along all axes but the slowest one, which
+  // is as long as the slab, and which grows while the footprint fits the
+  // cache.  The edge is never shorter than the halo along the axis so that the
+  // halo does not dominate the footprint.
+  const NeighborhoodRadiusType neighborhoodSearchExtent = this->GetNeighborhoodSearchExtent();
+  const NeighborhoodRadiusType neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+  const unsigned int           splitAxis = ImageDimension - 1;
+  const SizeValueType          auxiliaryPixelSize =
+    this->m_AuxiliaryImagePrecision == AuxiliaryImagePrecisionEnum::HALF ? sizeof(HalfType) : sizeof(RealType);
+  const SizeValueType          bytesPerVoxel = sizeof(InputPixelType) + 3 * auxiliaryPixelSize;
+
+  NeighborhoodRadiusType haloRadius;
+  SizeValueType          maximumEdge = 1;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    haloRadius[d] = neighborhoodSearchExtent[d] + neighborhoodPatchRadius[d];
+    if (d != splitAxis)
+    {
+      maximumEdge = std::max(maximumEdge, chunkRegion.GetSize(d));
+    }
+  }
+
+  auto computeTileSize = [&chunkRegion, &haloRadius, splitAxis](const SizeValueType edge) {
+    typename RegionType::SizeType tileSize = chunkRegion.GetSize();
+    for (unsigned int d = 0; d < splitAxis; d++)
+    {
+      tileSize[d] = std::min(std::max(edge, 2 * haloRadius[d] + 1), chunkRegion.GetSize(d));
+    }
+    return tileSize;
+  };
+  auto computeFootprint = [&haloRadius, bytesPerVoxel](const typename RegionType::SizeType & tileSize) {
+    SizeValueType footprint = bytesPerVoxel;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      footprint *= tileSize[d] + 2 * haloRadius[d];
+    }
+    return footprint;
+  };
+
+  SizeValueType edge = 1;
+  while (edge < maximumEdge && computeFootprint(computeTileSize(edge + 1)) <= this->m_TileCacheSize)
+  {
+    edge++;
+  }
+  const typename RegionType::SizeType tileSize = computeTileSize(edge);
+
+  // The tiles are anchored to the slab and visited in raster order.
+  typename RegionType::SizeType numberOfTiles;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    numberOfTiles[d] = (chunkRegion.GetSize(d) + tileSize[d] - 1) / tileSize[d];
+  }
+  const RegionType tileGridRegion(numberOfTiles);
+
+  std::vector<RegionType> tileRegions;
+  tileRegions.reserve(tileGridRegion.GetNumberOfPixels());
+  for (SizeValueType position = 0; position < tileGridRegion.GetNumberOfPixels(); position++)
+  {
+    const IndexType tileGridIndex = ComputeRegionIndex(tileGridRegion, position);
+
+    RegionType tileRegion = chunkRegion;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      const SizeValueType tileOffset = static_cast<SizeValueType>(tileGridIndex[d]) * tileSize[d];
+      tileRegion.SetIndex(d, chunkRegion.GetIndex(d) + static_cast<IndexValueType>(tileOffset));
+      tileRegion.SetSize(d, std::min(tileSize[d], chunkRegion.GetSize(d) - tileOffset));
+    }
+    tileRegions.push_back(tileRegion);
+  }
+  return tileRegions;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetRicianBiasSmoothingRadius() const
+  -> NeighborhoodRadiusType
+{
+  // Same kernel as the DiscreteGaussianImageFilter which smooths the bias
+  // (default maximum error and kernel width, image spacing taken into account).
+
+  NeighborhoodRadiusType radius;
+  radius.Fill(0);
+  if (!this->m_UseRicianNoiseModel)
+  {
+    return radius;
+  }
+
+  if (this->m_RicianBiasSmoother == RicianBiasSmootherEnum::RECURSIVE_GAUSSIAN)
+  {
+    const typename RegionType::SizeType & size = this->GetInput()->GetLargestPossibleRegion().GetSize();
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      radius[d] = size[d];
+    }
+    return radius;
+  }
+
+  RealType smoothingVariance = NumericTraits<RealType>::ZeroValue();
+  for (const SweepParameters & parameters : this->GetParameterSets())
+  {
+    smoothingVariance = std::max(smoothingVariance, parameters.m_SmoothingVariance);
+  }
+
+  const typename InputImageType::SpacingType & spacing = this->GetInput()->GetSpacing();
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    GaussianOperator<RealType, ImageDimension> gaussianOperator;
+    gaussianOperator.SetDirection(d);
+    gaussianOperator.SetVariance(smoothingVariance / itk::Math::sqr(spacing[d]));
+    gaussianOperator.SetMaximumError(0.01);
+    gaussianOperator.SetMaximumKernelWidth(32);
+    gaussianOperator.CreateDirectional();
+    radius[d] = gaussianOperator.GetRadius(d);
+  }
+  return radius;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeCenterImageRegion() const
+  -> RegionType
+{
+  const NeighborhoodRadiusType neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+  const NeighborhoodRadiusType smoothingRadius = this->GetRicianBiasSmoothingRadius();
+
+  NeighborhoodRadiusType centerRadius;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    centerRadius[d] = neighborhoodPatchRadius[d] + smoothingRadius[d];
+  }
+
+  RegionType centerImageRegion = this->GetOutput()->GetRequestedRegion();
+  centerImageRegion.PadByRadius(centerRadius);
+  centerImageRegion.Crop(this->GetInput()->GetLargestPossibleRegion());
+  return centerImageRegion;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeAuxiliaryImageRegion(
+  const RegionType & centerImageRegion) const -> RegionType
+{
+  // The intensity range is taken over the auxiliary region, so it must cover
+  // the whole image when the maximum intensity is computed (except with the
+  // masked execution, which computes it separately).  PatchMatch neighbors may
+  // lie anywhere in the image.
+  if ((this->m_ComputeMaximumInputPixelIntensity && !this->IsMaskedExecution()) ||
+      this->GetSearchStrategy() == SearchStrategyEnum::PATCH_MATCH)
+  {
+    return this->GetInput()->GetLargestPossibleRegion();
+  }
+
+  const NeighborhoodRadiusType neighborhoodSearchExtent = this->GetNeighborhoodSearchExtent();
+  const NeighborhoodRadiusType coarseSearchRadius = this->GetCoarseSearchRadius();
+
+  NeighborhoodRadiusType auxiliaryRadius;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    auxiliaryRadius[d] = neighborhoodSearchExtent[d] + this->GetNeighborhoodPatchRadius()[d];
+
+    // The coarse search compares the cells of the coarse patches of the
+    // coarse neighbors, whose voxels may lie one voxel further.
+    if (this->m_UseCoarseToFineSearch)
+    {
+      const SizeValueType coarsePatchRadius = (this->GetNeighborhoodPatchRadius()[d] + 1) / 2;
+      auxiliaryRadius[d] = std::max(auxiliaryRadius[d], 2 * (coarseSearchRadius[d] + coarsePatchRadius) + 1);
+    }
+  }
+
+  RegionType auxiliaryRegion = centerImageRegion;
+  auxiliaryRegion.PadByRadius(auxiliaryRadius);
+  auxiliaryRegion.Crop(this->GetInput()->GetLargestPossibleRegion());
+  return auxiliaryRegion;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::CropToAuxiliaryImageRegion(
+  const RealImageType * image,
+  const RegionType &    auxiliaryRegion) const -> RealImagePointer
+{
+  // The search addresses the mean, variance and residual images through the
+  // buffered region of the mean image, so they must all be laid out alike.
+
+  if (image->GetBufferedRegion() == auxiliaryRegion)
+  {
+    return const_cast<RealImageType *>(image);
+  }
+  if (!image->GetBufferedRegion().IsInside(auxiliaryRegion))
+  {
+    itkExceptionMacro("The buffered region of the local statistics image (" << image->GetBufferedRegion()
+                                                                             << ") does not cover the region "
+                                                                             << auxiliaryRegion << ".");
+  }
+
+  RealImagePointer croppedImage = RealImageType::New();
+  croppedImage->CopyInformation(image);
+  croppedImage->SetRegions(auxiliaryRegion);
+  croppedImage->Allocate();
+
+  ImageRegionConstIterator<RealImageType> ItI(image, auxiliaryRegion);
+  ImageRegionIterator<RealImageType>      ItO(croppedImage, auxiliaryRegion);
+  for (; !ItI.IsAtEnd(); ++ItI, ++ItO)
+  {
+    ItO.Set(ItI.Get());
+  }
+  return croppedImage;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::CopyToIntermediateOutput(
+  const RealImageType * image,
+  RealImageType *       outputImage) const
+{
+  outputImage->FillBuffer(NumericTraits<RealType>::ZeroValue());
+
+  RegionType overlapRegion = outputImage->GetBufferedRegion();
+  if (image == nullptr || !overlapRegion.Crop(image->GetBufferedRegion()))
+  {
+    return;
+  }
+
+  ImageRegionConstIterator<RealImageType> ItI(image, overlapRegion);
+  ImageRegionIterator<RealImageType>      ItO(outputImage, overlapRegion);
+  for (; !ItI.IsAtEnd(); ++ItI, ++ItO)
+  {
+    ItO.Set(ItI.Get());
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeMaskBoundingBox(
+  const RegionType & region) const -> RegionType
+{
+  const MaskImageType * maskImage = this->GetMaskImage();
+
+  RegionType boundingBox = region;
+  boundingBox.SetSize(typename RegionType::SizeType{});
+
+  RegionType maskRegion = region;
+  if (!maskRegion.Crop(maskImage->GetBufferedRegion()))
+  {
+    return boundingBox;
+  }
+
+  IndexType lowerIndex;
+  IndexType upperIndex;
+  bool      isEmpty = true;
+
+  ImageRegionConstIteratorWithIndex<MaskImageType> ItK(maskImage, maskRegion);
+  for (; !ItK.IsAtEnd(); ++ItK)
+  {
+    if (ItK.Get() == NumericTraits<MaskPixelType>::ZeroValue())
+    {
+      continue;
+    }
+    const IndexType index = ItK.GetIndex();
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      lowerIndex[d] = isEmpty ? index[d] : std::min(lowerIndex[d], index[d]);
+      upperIndex[d] = isEmpty ? index[d] : std::max(upperIndex[d], index[d]);
+    }
+    isEmpty = false;
+  }
+
+  if (!isEmpty)
+  {
+    boundingBox.SetIndex(lowerIndex);
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      boundingBox.SetSize(d, static_cast<SizeValueType>(upperIndex[d] - lowerIndex[d] + 1));
+    }
+  }
+  return boundingBox;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::IsMaskedExecution() const
+{
+  return this->m_UseMaskedExecution && this->GetMaskImage() != nullptr;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::BeforeThreadedGenerateData()
+{
+  Superclass::BeforeThreadedGenerateData();
+
+  const NeighborhoodRadiusType neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    if (this->m_CenterStride[d] < 1 || this->m_CenterStride[d] > 2 * neighborhoodPatchRadius[d] + 1)
+    {
+      itkExceptionMacro("The center stride (" << this->m_CenterStride << ") must be between 1 and the patch size ("
+                                              << 2 * neighborhoodPatchRadius[d] + 1 << ") along each axis.");
+    }
+  }
+
+  if (this->GetSearchStrategy() == SearchStrategyEnum::PATCH_MATCH)
+  {
+    if (this->m_PatchDistanceEngine != PatchDistanceEngineEnum::DIRECT || this->m_UseCoarseToFineSearch)
+    {
+      itkExceptionMacro("The PatchMatch search requires the DIRECT patch distance engine, without the coarse-to-fine "
+                        "search.");
+    }
+    if (this->GetNumberOfPatchMatchNeighbors() < 1)
+    {
+      itkExceptionMacro("The number of PatchMatch neighbors must be at least 1.");
+    }
+  }
+
+  if (!this->m_SweepParameters.empty() && this->m_PatchDistanceEngine != PatchDistanceEngineEnum::DIRECT)
+  {
+    itkExceptionMacro("The parameter sweep requires the DIRECT patch distance engine.");
+  }
+
+  const bool useHalfPrecision = this->m_AuxiliaryImagePrecision == AuxiliaryImagePrecisionEnum::HALF;
+  if (useHalfPrecision &&
+      (this->m_PatchDistanceEngine != PatchDistanceEngineEnum::DIRECT ||
+       this->GetSearchStrategy() == SearchStrategyEnum::PATCH_MATCH || this->m_UseCoarseToFineSearch))
+  {
+    itkExceptionMacro("The HALF auxiliary image precision requires the DIRECT patch distance engine and the "
+                      "SEARCH_NEIGHBORHOOD strategy, without the coarse-to-fine search.");
+  }
+
+  const RealImageType * localMeanImage = this->GetLocalMeanImage();
+  const RealImageType * localVarianceImage = this->GetLocalVarianceImage();
+  if ((localMeanImage == nullptr) != (localVarianceImage == nullptr))
+  {
+    itkExceptionMacro("The local mean and variance images must be set together.");
+  }
+
+  if (this->m_UseCoarseToFineSearch)
+  {
+    if (this->m_PatchDistanceEngine != PatchDistanceEngineEnum::DIRECT)
+    {
+      itkExceptionMacro("The coarse-to-fine search requires the DIRECT patch distance engine.");
+    }
+    if (this->m_NumberOfCoarseSearchCandidates < 1)
+    {
+      itkExceptionMacro("The number of coarse search candidates must be at least 1.");
+    }
+
+    // Every coarse offset is refined into the search offsets about its double.
+
+    const NeighborhoodOffsetListType neighborhoodSearchOffsetList = this->GetNeighborhoodSearchOffsetList();
+    const OffsetValueType refinementRadius = static_cast<OffsetValueType>(this->m_CoarseSearchRefinementRadius);
+
+    NeighborhoodType coarseSearchNeighborhood;
+    coarseSearchNeighborhood.SetRadius(this->GetCoarseSearchRadius());
+
+    this->m_CoarseSearchOffsetList.clear();
+    this->m_CoarseToFineSearchOffsets.clear();
+    for (unsigned int n = 0; n < coarseSearchNeighborhood.Size(); n++)
+    {
+      const NeighborhoodOffsetType coarseOffset = coarseSearchNeighborhood.GetOffset(n);
+
+      std::vector<unsigned int> fineSearchOffsets;
+      for (unsigned int m = 0; m < neighborhoodSearchOffsetList.size(); m++)
+      {
+        bool isRefined = true;
+        for (unsigned int d = 0; d < ImageDimension; d++)
+        {
+          const OffsetValueType distance = neighborhoodSearchOffsetList[m][d] - 2 * coarseOffset[d];
+          isRefined = isRefined && std::abs(distance) <= refinementRadius;
+        }
+        if (isRefined)
+        {
+          fineSearchOffsets.push_back(m);
+        }
+      }
+      if (!fineSearchOffsets.empty())
+      {
+        this->m_CoarseSearchOffsetList.push_back(coarseOffset);
+        this->m_CoarseToFineSearchOffsets.push_back(fineSearchOffsets);
+      }
+    }
+  }
+
+  const InputImageType * inputImage = this->GetInput();
+
+  const unsigned int numberOfChannels = this->GetNumberOfChannels();
+  const unsigned int numberOfOutputs = this->GetNumberOfParameterSets() * numberOfChannels;
+  for (unsigned int c = 1; c < numberOfChannels; c++)
+  {
+    if (!this->GetChannel(c))
+    {
+      itkExceptionMacro("Channel " << c << " is not set.");
+    }
+  }
+
+  // Patches are clipped to the whole image rather than to the requested
+  // region so that streamed pieces match a single run.  The auxiliary images
+  // only cover the search neighborhoods and patches of the centers.
+
+  this->m_TargetImageRegion = inputImage->GetLargestPossibleRegion();
+
+  this->m_CenterImageRegion = this->ComputeCenterImageRegion();
+
+  // With the masked execution, only the centers whose patch overlaps the
+  // bounding box of the mask are visited.
+
+  const bool isMaskedExecution = this->IsMaskedExecution();
+  if (isMaskedExecution)
+  {
+    this->m_MaskBoundingBox = this->ComputeMaskBoundingBox(this->m_CenterImageRegion);
+
+    RegionType maskCenterRegion = this->m_MaskBoundingBox;
+    maskCenterRegion.PadByRadius(neighborhoodPatchRadius);
+    if (this->m_MaskBoundingBox.GetNumberOfPixels() == 0 || !this->m_CenterImageRegion.Crop(maskCenterRegion))
+    {
+      this->m_CenterImageRegion.SetSize(typename RegionType::SizeType{});
+    }
+  }
+
+  const RegionType auxiliaryRegion = this->ComputeAuxiliaryImageRegion(this->m_CenterImageRegion);
+
+  // The local mean and variance, the residuals (input minus local mean) that
+  // the patch distances are computed from, and the intensity range all come
+  // from a single sweep over the input.  With precomputed local statistics
+  // only the residuals are formed, as the statistics filter forms them.
+
+  typedef LocalMeanAndVarianceImageFilter<InputImageType, RealImageType> LocalStatisticsFilterType;
+  typename LocalStatisticsFilterType::Pointer localStatisticsFilter = LocalStatisticsFilterType::New();
+  localStatisticsFilter->SetRadius(this->GetNeighborhoodRadiusForLocalMeanAndVariance());
+  localStatisticsFilter->ComputeResidualOn();
+  localStatisticsFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+
+  if (localMeanImage)
+  {
+    this->m_MeanImage = this->CropToAuxiliaryImageRegion(localMeanImage, auxiliaryRegion);
+    this->m_VarianceImage = this->CropToAuxiliaryImageRegion(localVarianceImage, auxiliaryRegion);
+
+    this->m_ResidualImage = RealImageType::New();
+    this->m_ResidualImage->CopyInformation(inputImage);
+    this->m_ResidualImage->SetRegions(auxiliaryRegion);
+    this->m_ResidualImage->Allocate();
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->ParallelizeImageRegion(
+      auxiliaryRegion,
+      [this, inputImage](const RegionType & region) {
+        ImageRegionConstIterator<InputImageType> ItI(inputImage, region);
+        ImageRegionConstIterator<RealImageType>  ItM(this->m_MeanImage, region);
+        ImageRegionIterator<RealImageType>       ItR(this->m_ResidualImage, region);
+        for (; !ItI.IsAtEnd(); ++ItI, ++ItM, ++ItR)
+        {
+          ItR.Set(static_cast<RealType>(ItI.Get()) - ItM.Get());
+        }
+      },
+      nullptr);
+  }
+  else
+  {
+    localStatisticsFilter->SetInput(inputImage);
+
+    this->m_MeanImage = localStatisticsFilter->GetMeanOutput();
+    this->m_VarianceImage = localStatisticsFilter->GetVarianceOutput();
+    this->m_ResidualImage = localStatisticsFilter->GetResidualOutput();
+    this->m_MeanImage->SetRequestedRegion(auxiliaryRegion);
+    this->m_VarianceImage->SetRequestedRegion(auxiliaryRegion);
+    this->m_ResidualImage->SetRequestedRegion(auxiliaryRegion);
+    localStatisticsFilter->Update();
+    this->m_MeanImage->DisconnectPipeline();
+    this->m_VarianceImage->DisconnectPipeline();
+    this->m_ResidualImage->DisconnectPipeline();
+  }
+
+  if (this->m_ComputeMaximumInputPixelIntensity && (isMaskedExecution || localMeanImage))
+  {
+    // The intensity range does not come from the local statistics, which
+    // only cover the mask or are precomputed, but the whole input image is
+    // buffered.  Every work unit keeps its own range, merged at the end.
+    this->m_MaximumInputPixelIntensity = NumericTraits<RealType>::NonpositiveMin();
+    this->m_MinimumInputPixelIntensity = NumericTraits<RealType>::max();
+
+    std::mutex rangeMutex;
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->ParallelizeImageRegion(
+      inputImage->GetLargestPossibleRegion(),
+      [this, inputImage, &rangeMutex](const RegionType & region) {
+        RealType maximum = NumericTraits<RealType>::NonpositiveMin();
+        RealType minimum = NumericTraits<RealType>::max();
+
+        ImageRegionConstIterator<InputImageType> ItI(inputImage, region);
+        for (; !ItI.IsAtEnd(); ++ItI)
+        {
+          const RealType intensity = static_cast<RealType>(ItI.Get());
+          maximum = std::max(maximum, intensity);
+          minimum = std::min(minimum, intensity);
+        }
+
+        const std::lock_guard<std::mutex> lock(rangeMutex);
+        this->m_MaximumInputPixelIntensity = std::max(this->m_MaximumInputPixelIntensity, maximum);
+        this->m_MinimumInputPixelIntensity = std::min(this->m_MinimumInputPixelIntensity, minimum);
+      },
+      nullptr);
+  }
+  else if (this->m_ComputeMaximumInputPixelIntensity)
+  {
+    // The auxiliary region covers the whole image in this case.
+    this->m_MaximumInputPixelIntensity = static_cast<RealType>(localStatisticsFilter->GetMaximum());
+    this->m_MinimumInputPixelIntensity = static_cast<RealType>(localStatisticsFilter->GetMinimum());
+  }
+
+  this->m_PatchMeanImage = nullptr;
+  this->m_PatchInverseStandardDeviationImage = nullptr;
+  if (this->GetSimilarityMetric() == SimilarityMetricEnum::PEARSON_CORRELATION)
+  {
+    this->ComputePatchStatistics();
+  }
+
+  if (this->GetSearchStrategy() == SearchStrategyEnum::PATCH_MATCH)
+  {
+    this->ComputePatchMatchNeighbors();
+  }
+
+  // The other channels only need their own local means and residuals, for
+  // the Rician bias.
+
+  this->m_ChannelMeanImages.assign(numberOfChannels, nullptr);
+  this->m_ChannelResidualImages.assign(numberOfChannels, nullptr);
+  this->m_ChannelMeanImages[0] = this->m_MeanImage;
+  this->m_ChannelResidualImages[0] = this->m_ResidualImage;
+
+  for (unsigned int c = 1; c < numberOfChannels && this->m_UseRicianNoiseModel; c++)
+  {
+    typename LocalStatisticsFilterType::Pointer channelStatisticsFilter = LocalStatisticsFilterType::New();
+    channelStatisticsFilter->SetInput(this->GetChannel(c));
+    channelStatisticsFilter->SetRadius(this->GetNeighborhoodRadiusForLocalMeanAndVariance());
+    channelStatisticsFilter->ComputeResidualOn();
+    channelStatisticsFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+
+    this->m_ChannelMeanImages[c] = channelStatisticsFilter->GetMeanOutput();
+    this->m_ChannelResidualImages[c] = channelStatisticsFilter->GetResidualOutput();
+    this->m_ChannelMeanImages[c]->SetRequestedRegion(auxiliaryRegion);
+    channelStatisticsFilter->GetVarianceOutput()->SetRequestedRegion(auxiliaryRegion);
+    this->m_ChannelResidualImages[c]->SetRequestedRegion(auxiliaryRegion);
+    channelStatisticsFilter->Update();
+    this->m_ChannelMeanImages[c]->DisconnectPipeline();
+    this->m_ChannelResidualImages[c]->DisconnectPipeline();
+  }
+
+  // With half precision, the images read by the search replace the RealType
+  // images, each of which is released as soon as it is converted.  The
+  // patch statistics of PEARSON_CORRELATION are computed beforehand, and the
+  // local mean is expanded back after the search where it is needed.
+
+  this->m_HalfMeanImage = nullptr;
+  this->m_HalfVarianceImage = nullptr;
+  this->m_HalfResidualImages.assign(numberOfChannels, nullptr);
+  this->m_HalfResidualScales.assign(numberOfChannels, NumericTraits<RealType>::OneValue());
+  if (useHalfPrecision)
+  {
+    this->m_HalfMeanImage = this->ConvertToHalfImage(this->m_MeanImage, this->m_HalfMeanScale);
+    this->m_MeanImage = nullptr;
+    this->m_ChannelMeanImages[0] = nullptr;
+
+    this->m_HalfVarianceImage = this->ConvertToHalfImage(this->m_VarianceImage, this->m_HalfVarianceScale);
+    this->m_VarianceImage = nullptr;
+
+    this->m_ResidualImage = nullptr;
+    for (unsigned int c = 0; c < numberOfChannels; c++)
+    {
+      if (this->m_ChannelResidualImages[c])
+      {
+        this->m_HalfResidualImages[c] =
+          this->ConvertToHalfImage(this->m_ChannelResidualImages[c], this->m_HalfResidualScales[c]);
+        this->m_ChannelResidualImages[c] = nullptr;
+      }
+    }
+  }
+
+  // The Rician bias is needed wherever it is smoothed into the output.
+
+  this->m_RicianBiasImages.clear();
+  if (this->m_UseRicianNoiseModel)
+  {
+    RegionType ricianBiasRegion = this->GetOutput()->GetRequestedRegion();
+    ricianBiasRegion.PadByRadius(this->GetRicianBiasSmoothingRadius());
+    ricianBiasRegion.Crop(inputImage->GetLargestPossibleRegion());
+
+    // The bias of the masked voxels is smoothed from the voxels within the
+    // kernel radius of the bounding box of the mask.
+    if (isMaskedExecution && this->m_MaskBoundingBox.GetNumberOfPixels() > 0)
+    {
+      RegionType maskRicianBiasRegion = this->m_MaskBoundingBox;
+      maskRicianBiasRegion.PadByRadius(this->GetRicianBiasSmoothingRadius());
+      ricianBiasRegion.Crop(maskRicianBiasRegion);
+    }
+
+    for (unsigned int c = 0; c < numberOfOutputs; c++)
+    {
+      RealImagePointer ricianBiasImage = RealImageType::New();
+      ricianBiasImage->CopyInformation(inputImage);
+      ricianBiasImage->SetRegions(ricianBiasRegion);
+      ricianBiasImage->Allocate(true);
+      this->m_RicianBiasImages.push_back(ricianBiasImage);
+    }
+  }
+
+  this->AllocateOutputs();
+  // Output buffers need to be zero initialized
+  for (unsigned int c = 0; c < numberOfOutputs; c++)
+  {
+    this->GetOutput(c)->FillBuffer(0.0);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::IsPatchCenter(
+  const IndexType & index) const
+{
+  // The grid is anchored at the start of the target region so that it does
+  // not depend on how the region is split between threads.  The last voxel of
+  // each axis is always a center so that the trailing voxels are covered.
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    if (!this->IsPatchCenterAlongAxis(index[d], d))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::IsPatchCenterAlongAxis(
+  const IndexValueType index,
+  const unsigned int   axis) const
+{
+  const RegionType &  targetImageRegion = this->m_TargetImageRegion;
+  const SizeValueType position = static_cast<SizeValueType>(index - targetImageRegion.GetIndex(axis));
+  return position % this->m_CenterStride[axis] == 0 || position + 1 == targetImageRegion.GetSize(axis);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::IsNeighborPreselected(
+  const RealType    meanCenterPixel,
+  const RealType    varianceCenterPixel,
+  const IndexType & neighborhoodIndex) const
+{
+  return this->IsNeighborPreselected(meanCenterPixel,
+                                     varianceCenterPixel,
+                                     this->GetInput()->GetPixel(neighborhoodIndex),
+                                     this->m_MeanImage->GetPixel(neighborhoodIndex),
+                                     this->m_VarianceImage->GetPixel(neighborhoodIndex));
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::IsNeighborPreselected(
+  const RealType       meanCenterPixel,
+  const RealType       varianceCenterPixel,
+  const InputPixelType inputNeighborhoodPixel,
+  const RealType       meanNeighborhoodPixel,
+  const RealType       varianceNeighborhoodPixel) const
+{
+  SweepParameters parameters;
+  parameters.m_MeanThreshold = this->m_MeanThreshold;
+  parameters.m_VarianceThreshold = this->m_VarianceThreshold;
+  return this->IsNeighborPreselected(meanCenterPixel,
+                                     varianceCenterPixel,
+                                     inputNeighborhoodPixel,
+                                     meanNeighborhoodPixel,
+                                     varianceNeighborhoodPixel,
+                                     parameters);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::IsNeighborPreselected(
+  const RealType          meanCenterPixel,
+  const RealType          varianceCenterPixel,
+  const InputPixelType    inputNeighborhoodPixel,
+  const RealType          meanNeighborhoodPixel,
+  const RealType          varianceNeighborhoodPixel,
+  const SweepParameters & parameters) const
+{
+  if (inputNeighborhoodPixel <= 0)
+  {
+    return false;
+  }
+
+  if (meanNeighborhoodPixel <= this->m_Epsilon || varianceNeighborhoodPixel <= this->m_Epsilon)
+  {
+    return false;
+  }
+
+  const RealType meanRatio = meanCenterPixel / meanNeighborhoodPixel;
+  const RealType meanRatioInverse = (this->m_MaximumInputPixelIntensity - meanCenterPixel) /
+                                    (this->m_MaximumInputPixelIntensity - meanNeighborhoodPixel);
+
+  const RealType varianceRatio = varianceCenterPixel / varianceNeighborhoodPixel;
+
+  return ((meanRatio > parameters.m_MeanThreshold &&
+           meanRatio < itk::NumericTraits<RealType>::OneValue() / parameters.m_MeanThreshold) ||
+          (meanRatioInverse > parameters.m_MeanThreshold &&
+           meanRatioInverse < itk::NumericTraits<RealType>::OneValue() / parameters.m_MeanThreshold)) &&
+         varianceRatio > parameters.m_VarianceThreshold &&
+         varianceRatio < itk::NumericTraits<RealType>::OneValue() / parameters.m_VarianceThreshold;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GenerateChunkData(
+  const RegionType & region,
+  ChunkAccumulator & accumulator)
+{
+  const InputImageType * inputImage = this->GetInput();
+
+  RegionType targetImageRegion = this->GetTargetImageRegion();
+
+  accumulator.m_Region = region;
+  accumulator.m_Region.PadByRadius(this->GetNeighborhoodPatchRadius());
+  accumulator.m_Region.Crop(targetImageRegion);
+
+  const unsigned int numberOfOutputs = this->GetNumberOfParameterSets() * this->GetNumberOfChannels();
+  for (unsigned int c = 0; c < numberOfOutputs; c++)
+  {
+    RealImagePointer estimateImage = RealImageType::New();
+    estimateImage->CopyInformation(inputImage);
+    estimateImage->SetRegions(accumulator.m_Region);
+    estimateImage->Allocate(true);
+    accumulator.m_EstimateImages.push_back(estimateImage);
+
+    if (this->m_UseRicianNoiseModel)
+    {
+      RealImagePointer ricianBiasImage = RealImageType::New();
+      ricianBiasImage->CopyInformation(inputImage);
+      ricianBiasImage->SetRegions(accumulator.m_Region);
+      ricianBiasImage->Allocate();
+      ricianBiasImage->FillBuffer(-NumericTraits<RealType>::OneValue());
+      accumulator.m_RicianBiasImages.push_back(ricianBiasImage);
+    }
+  }
+
+  if (this->m_PatchDistanceEngine == PatchDistanceEngineEnum::SUMMED_AREA_TABLE)
+  {
+    this->GenerateChunkDataWithSummedAreaTables(region, accumulator);
+    return;
+  }
+
+  // The common isotropic patch radii get kernels with compile-time sizes.
+
+  const NeighborhoodRadiusType neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+
+  bool isIsotropicPatch = true;
+  for (unsigned int d = 1; d < ImageDimension; d++)
+  {
+    isIsotropicPatch = isIsotropicPatch && neighborhoodPatchRadius[d] == neighborhoodPatchRadius[0];
+  }
+
+  const bool useHalfPrecision = this->m_AuxiliaryImagePrecision == AuxiliaryImagePrecisionEnum::HALF;
+
+  if (isIsotropicPatch && neighborhoodPatchRadius[0] == 1)
+  {
+    if (useHalfPrecision)
+    {
+      this->template GenerateChunkDataWithDirectDistances<1, HalfType>(region, accumulator);
+    }
+    else
+    {
+      this->template GenerateChunkDataWithDirectDistances<1, RealType>(region, accumulator);
+    }
+  }
+  else if (isIsotropicPatch && neighborhoodPatchRadius[0] == 2)
+  {
+    if (useHalfPrecision)
+    {
+      this->template GenerateChunkDataWithDirectDistances<2, HalfType>(region, accumulator);
+    }
+    else
+    {
+      this->template GenerateChunkDataWithDirectDistances<2, RealType>(region, accumulator);
+    }
+  }
+  else if (useHalfPrecision)
+  {
+    this->template GenerateChunkDataWithDirectDistances<0, HalfType>(region, accumulator);
+  }
+  else
+  {
+    this->template GenerateChunkDataWithDirectDistances<0, RealType>(region, accumulator);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GenerateChunkDataWithDirectDistances(
+  const RegionType & region,
+  ChunkAccumulator & accumulator)
+{
+  typedef DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> ChunkType;
+  typedef typename ChunkType::AuxiliaryImageType             AuxiliaryImageType;
+
+  ChunkType chunk;
+  this->InitializeDirectDistanceChunk(region, accumulator, chunk);
+
+  TotalProgressReporter progress(this, this->m_CenterImageRegion.GetNumberOfPixels());
+
+  for (const RegionType & tileRegion : chunk.m_TileRegions)
+  {
+    chunk.m_TraversalRegion = tileRegion;
+    this->SetUpSymmetricPatchDistances(chunk);
+    if (chunk.m_UseTileStatistics)
+    {
+      this->GatherTileStatistics(chunk);
+    }
+
+    ImageRegionConstIteratorWithIndex<AuxiliaryImageType> ItM(chunk.m_MeanImage, chunk.m_TraversalRegion);
+
+    for (; !ItM.IsAtEnd(); ++ItM, chunk.m_CenterPosition++)
+    {
+      this->RecycleSymmetricPatchDistanceSlot(chunk);
+
+      if (this->IsPatchCenter(ItM.GetIndex()))
+      {
+        this->SetUpDirectDistanceCenter(chunk, ItM.GetIndex());
+
+        if (chunk.m_InputCenterPixel > 0 && chunk.m_MeanCenterPixel > this->m_Epsilon &&
+            chunk.m_VarianceCenterPixel > this->m_Epsilon &&
+            (!chunk.m_MaskImage ||
+             chunk.m_MaskImage->GetPixel(chunk.m_CenterIndex) != NumericTraits<MaskPixelType>::ZeroValue()))
+        {
+          if (this->m_UseCoarseToFineSearch)
+          {
+            this->SelectCellSearchOffsets(chunk, this->ComputeCellIndex(chunk.m_CenterIndex));
+          }
+          if (chunk.m_UsePatchMatch)
+          {
+            this->SelectPatchMatchNeighbors(chunk);
+          }
+          this->ComputeMinimumDistances(chunk);
+          this->StoreRicianBiases(chunk);
+          this->WeightNeighbors(chunk);
+        }
+        else
+        {
+          std::fill(chunk.m_MaxWeights.begin(), chunk.m_MaxWeights.end(), NumericTraits<RealType>::OneValue());
+        }
+
+        this->AccumulateCenterEstimates(chunk);
+      }
+
+      progress.CompletedPixel();
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::InitializeDirectDistanceChunk(
+  const RegionType &                                   region,
+  ChunkAccumulator &                                   accumulator,
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  typedef DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> ChunkType;
+
+  chunk.m_Region = region;
+  chunk.m_Accumulator = &accumulator;
+  chunk.m_InputImage = this->GetInput();
+  chunk.m_MaskImage = this->GetMaskImage();
+
+  // The auxiliary images are read with the pixel type of their storage
+  // precision, and expanded to RealType and scaled back as they are read.
+  // The row sums of the residuals are scaled once per patch, by the square
+  // of their power of two scale.
+
+  AuxiliaryImages<TAuxiliaryPixel> auxiliaryImages;
+  this->GetAuxiliaryImages(auxiliaryImages);
+  chunk.m_MeanImage = auxiliaryImages.m_MeanImage;
+  chunk.m_VarianceImage = auxiliaryImages.m_VarianceImage;
+  chunk.m_ResidualImage = auxiliaryImages.m_ResidualImages[0];
+  chunk.m_MeanScale = auxiliaryImages.m_MeanScale;
+  chunk.m_VarianceScale = auxiliaryImages.m_VarianceScale;
+  chunk.m_ResidualScale = auxiliaryImages.m_ResidualScales[0];
+
+  chunk.m_TargetImageRegion = this->GetTargetImageRegion();
+  chunk.m_SearchImageRegion = chunk.m_MeanImage->GetBufferedRegion();
+
+  const NeighborhoodRadiusType     neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+  const NeighborhoodOffsetListType neighborhoodPatchOffsetList = this->GetNeighborhoodPatchOffsetList();
+
+  // With PatchMatch the search offsets are those of the neighbors of the
+  // current center, followed by the zero offset.
+
+  chunk.m_UsePatchMatch = this->GetSearchStrategy() == SearchStrategyEnum::PATCH_MATCH;
+
+  chunk.m_NeighborhoodSearchExtent = this->GetNeighborhoodSearchExtent();
+  chunk.m_NeighborhoodSearchOffsetList = this->GetNeighborhoodSearchOffsetList();
+  if (chunk.m_UsePatchMatch)
+  {
+    chunk.m_NeighborhoodSearchExtent.Fill(0);
+    chunk.m_NeighborhoodSearchOffsetList.assign(1, NeighborhoodOffsetType{});
+  }
+
+  const NeighborhoodOffsetListType & neighborhoodSearchOffsetList = chunk.m_NeighborhoodSearchOffsetList;
+
+  chunk.m_NeighborhoodSearchSize = static_cast<unsigned int>(neighborhoodSearchOffsetList.size());
+  chunk.m_CenterSearchOffset = FindCenterSearchOffset(neighborhoodSearchOffsetList);
+
+  // The patches are processed one contiguous row (along the first axis) at a
+  // time, directly on the image buffers.  If the patch radius is known at
+  // compile time (VPatchRadius > 0) the row kernels are unrolled and the
+  // scratch storage lives on the stack.
+
+  chunk.m_RowLength = VPatchRadius > 0 ? ChunkType::FixedRowLength : 2 * neighborhoodPatchRadius[0] + 1;
+  chunk.m_NeighborhoodPatchSize = VPatchRadius > 0 ? ChunkType::FixedPatchSize : this->GetNeighborhoodPatchSize();
+  chunk.m_NumberOfRows = chunk.m_NeighborhoodPatchSize / chunk.m_RowLength;
+
+  chunk.m_InputBuffer = chunk.m_InputImage->GetBufferPointer();
+  chunk.m_MeanBuffer = chunk.m_MeanImage->GetBufferPointer();
+  chunk.m_VarianceBuffer = chunk.m_VarianceImage->GetBufferPointer();
+
+  // The weights found on the input image are applied to every channel.  The
+  // Rician bias of each channel comes from its own residuals, which share the
+  // buffered region (and hence the buffer offsets) of those of the input.
+  // Every parameter set has its own estimates and bias maps, in the order of
+  // the outputs.
+
+  chunk.m_NumberOfChannels = this->GetNumberOfChannels();
+  chunk.m_NumberOfBiasChannels = this->m_UseRicianNoiseModel ? chunk.m_NumberOfChannels : 0;
+  chunk.m_NumberOfDistanceChannels = std::max(chunk.m_NumberOfBiasChannels, 1u);
+  chunk.m_ParameterSets = this->GetParameterSets();
+  chunk.m_NumberOfParameterSets = static_cast<unsigned int>(chunk.m_ParameterSets.size());
+  chunk.m_NumberOfOutputs = chunk.m_NumberOfParameterSets * chunk.m_NumberOfChannels;
+
+  chunk.m_ChannelImages.resize(chunk.m_NumberOfChannels);
+  chunk.m_ChannelBuffers.resize(chunk.m_NumberOfChannels);
+  chunk.m_EstimateBuffers.resize(chunk.m_NumberOfOutputs);
+  for (unsigned int c = 0; c < chunk.m_NumberOfChannels; c++)
+  {
+    chunk.m_ChannelImages[c] = this->GetChannel(c);
+    chunk.m_ChannelBuffers[c] = chunk.m_ChannelImages[c]->GetBufferPointer();
+  }
+  for (unsigned int o = 0; o < chunk.m_NumberOfOutputs; o++)
+  {
+    chunk.m_EstimateBuffers[o] = accumulator.m_EstimateImages[o]->GetBufferPointer();
+  }
+
+  chunk.m_ResidualBuffers.resize(chunk.m_NumberOfDistanceChannels);
+  chunk.m_SquaredResidualScales.resize(chunk.m_NumberOfDistanceChannels);
+  chunk.m_RicianBiasBuffers.resize(chunk.m_NumberOfParameterSets * chunk.m_NumberOfBiasChannels);
+  for (unsigned int c = 0; c < chunk.m_NumberOfDistanceChannels; c++)
+  {
+    chunk.m_ResidualBuffers[c] = auxiliaryImages.m_ResidualImages[c]->GetBufferPointer();
+    chunk.m_SquaredResidualScales[c] = auxiliaryImages.m_ResidualScales[c] * auxiliaryImages.m_ResidualScales[c];
+  }
+  for (unsigned int b = 0; b < chunk.m_RicianBiasBuffers.size(); b++)
+  {
+    chunk.m_RicianBiasBuffers[b] = accumulator.m_RicianBiasImages[b]->GetBufferPointer();
+  }
+
+  // With PEARSON_CORRELATION, the patch statistics share the buffered region
+  // (and hence the buffer offsets) of the residuals.
+
+  chunk.m_UsePearsonCorrelation = this->GetSimilarityMetric() == SimilarityMetricEnum::PEARSON_CORRELATION;
+
+  chunk.m_PatchMeanBuffer = chunk.m_UsePearsonCorrelation ? this->m_PatchMeanImage->GetBufferPointer() : nullptr;
+  chunk.m_PatchInverseStandardDeviationBuffer =
+    chunk.m_UsePearsonCorrelation ? this->m_PatchInverseStandardDeviationImage->GetBufferPointer() : nullptr;
+
+  // Centers whose search window, padded by the patch radius, lies inside the
+  // target region (the interior face) need no bounds checking at all.  Their
+  // neighbors and patch rows are addressed with precomputed buffer offsets,
+  // while the centers of the boundary faces clip every patch row to the
+  // target region.  The centers are still visited in raster order so that the
+  // result does not depend on the face a center belongs to.
+
+  NeighborhoodRadiusType interiorRadius;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    interiorRadius[d] = chunk.m_NeighborhoodSearchExtent[d] + neighborhoodPatchRadius[d];
+  }
+  chunk.m_InteriorRegion = chunk.m_TargetImageRegion;
+  if (!chunk.m_InteriorRegion.ShrinkByRadius(interiorRadius) || !chunk.m_InteriorRegion.Crop(region))
+  {
+    chunk.m_InteriorRegion.SetSize(typename RegionType::SizeType{});
+  }
+
+  NeighborhoodOffsetListType rowOffsetList;
+  for (SizeValueType row = 0; row < chunk.m_NumberOfRows; row++)
+  {
+    rowOffsetList.push_back(neighborhoodPatchOffsetList[row * chunk.m_RowLength]);
+  }
+
+  chunk.m_InputSearchOffsets = ComputeBufferOffsets(chunk.m_InputImage, neighborhoodSearchOffsetList);
+  chunk.m_MeanSearchOffsets = ComputeBufferOffsets(chunk.m_MeanImage, neighborhoodSearchOffsetList);
+  chunk.m_VarianceSearchOffsets = ComputeBufferOffsets(chunk.m_VarianceImage, neighborhoodSearchOffsetList);
+  chunk.m_ResidualSearchOffsets = ComputeBufferOffsets(chunk.m_ResidualImage, neighborhoodSearchOffsetList);
+
+  chunk.m_ResidualRowOffsets = ComputeBufferOffsets(chunk.m_ResidualImage, rowOffsetList);
+  chunk.m_AccumulatorRowOffsets = ComputeBufferOffsets(accumulator.m_EstimateImages[0].GetPointer(), rowOffsetList);
+
+  chunk.m_ChannelSearchOffsets.resize(chunk.m_NumberOfChannels);
+  chunk.m_ChannelRowOffsets.resize(chunk.m_NumberOfChannels);
+  for (unsigned int c = 0; c < chunk.m_NumberOfChannels; c++)
+  {
+    chunk.m_ChannelSearchOffsets[c] = ComputeBufferOffsets(chunk.m_ChannelImages[c], neighborhoodSearchOffsetList);
+    chunk.m_ChannelRowOffsets[c] = ComputeBufferOffsets(chunk.m_ChannelImages[c], rowOffsetList);
+  }
+
+  // The PatchMatch neighbors of a center must lie in the patch interior
+  // region for the center to be interior.
+
+  chunk.m_PatchInteriorRegion = chunk.m_TargetImageRegion;
+  if (!chunk.m_PatchInteriorRegion.ShrinkByRadius(neighborhoodPatchRadius))
+  {
+    chunk.m_PatchInteriorRegion.SetSize(typename RegionType::SizeType{});
+  }
+  chunk.m_NumberOfPatchMatchNeighbors = this->GetNumberOfPatchMatchNeighbors();
+
+  // All the neighbors are searched, unless the coarse-to-fine preselection
+  // selects those of the cell of each center.
+
+  chunk.m_SearchOffsets.resize(chunk.m_NeighborhoodSearchSize);
+  std::iota(chunk.m_SearchOffsets.begin(), chunk.m_SearchOffsets.end(), 0u);
+
+  chunk.m_HasSearchOffsetsCell = false;
+  chunk.m_IsSearchOffset.assign(chunk.m_NeighborhoodSearchSize, false);
+  if (this->m_UseCoarseToFineSearch)
+  {
+    chunk.m_CellRegion = this->ComputeCoarseSearchCandidates(region, chunk.m_CellCandidates);
+  }
+
+  // The symmetric patch distances pair every search offset with its opposite.
+
+  const unsigned int noSymmetricEntry = NumericTraits<unsigned int>::max();
+
+  chunk.m_UseSymmetricDistances = this->m_UseSymmetricPatchDistances && !chunk.m_UsePatchMatch;
+  chunk.m_OppositeSearchOffsets.assign(chunk.m_UseSymmetricDistances ? chunk.m_NeighborhoodSearchSize : 0,
+                                       noSymmetricEntry);
+  for (unsigned int m = 0; m < chunk.m_OppositeSearchOffsets.size(); m++)
+  {
+    const auto opposite = std::find(neighborhoodSearchOffsetList.begin(),
+                                    neighborhoodSearchOffsetList.end(),
+                                    NeighborhoodOffsetType{} - neighborhoodSearchOffsetList[m]);
+    if (opposite != neighborhoodSearchOffsetList.end())
+    {
+      chunk.m_OppositeSearchOffsets[m] = static_cast<unsigned int>(opposite - neighborhoodSearchOffsetList.begin());
+    }
+  }
+  chunk.m_SymmetricEntries.resize(chunk.m_NeighborhoodSearchSize);
+  chunk.m_IsForwardSearchOffset.resize(chunk.m_NeighborhoodSearchSize);
+  chunk.m_ForwardRasterSteps.assign(chunk.m_NeighborhoodSearchSize, 0);
+  chunk.m_CenterPosition = 0;
+
+  // With the tiled traversal, the input, mean and variance of the tile and of
+  // its search halo are gathered into one interleaved buffer for the
+  // preselection.  PatchMatch neighbors may lie anywhere in the image, so they
+  // are still read from the images.
+
+  chunk.m_TileRegions = this->SplitChunkRegionIntoTiles(region);
+  chunk.m_UseTileStatistics = this->m_UseTiledTraversal && !chunk.m_UsePatchMatch;
+  chunk.m_TileStatisticsSearchOffsets.resize(chunk.m_NeighborhoodSearchSize);
+
+  // Tiles do not visit the centers of the slab in raster order, so every voxel
+  // of the Rician bias map records the raster position (plus one) of the
+  // center whose bias it holds, and only takes that of a center further along.
+  // It ends up with the bias it would have had without tiles.
+
+  if (chunk.m_TileRegions.size() > 1 && chunk.m_NumberOfBiasChannels > 0)
+  {
+    chunk.m_RicianBiasPositions.assign(accumulator.m_EstimateImages[0]->GetBufferedRegion().GetNumberOfPixels(), 0);
+  }
+
+  chunk.m_IsInteriorCenter = false;
+  chunk.m_ChannelCenterOffsets.resize(chunk.m_NumberOfChannels);
+
+  // The weighted intensities of the channels live on the stack if there is a
+  // single output of a patch size fixed at compile time.
+
+  const bool isFixedScratch = VPatchRadius > 0 && chunk.m_NumberOfOutputs == 1;
+
+  chunk.m_DynamicWeightedAverageIntensities.resize(
+    isFixedScratch ? 0 : chunk.m_NumberOfOutputs * chunk.m_NeighborhoodPatchSize);
+  chunk.m_WeightedAverageIntensities = isFixedScratch ? chunk.m_FixedWeightedAverageIntensities.data()
+                                                      : chunk.m_DynamicWeightedAverageIntensities.data();
+
+  chunk.m_MinimumDistances.resize(chunk.m_NumberOfParameterSets * chunk.m_NumberOfDistanceChannels);
+  chunk.m_CutoffDistances.resize(chunk.m_NumberOfParameterSets);
+  chunk.m_MaxWeights.resize(chunk.m_NumberOfParameterSets);
+  chunk.m_SumsOfWeights.resize(chunk.m_NumberOfParameterSets);
+  chunk.m_IsPreselectedBySet.resize(chunk.m_NumberOfParameterSets);
+  chunk.m_CandidateSearchOffsets.reserve(chunk.m_NeighborhoodSearchSize);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SetUpSymmetricPatchDistances(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  const unsigned int noSymmetricEntry = NumericTraits<unsigned int>::max();
+  const RealType     noSymmetricDistance = NumericTraits<RealType>::NonpositiveMin();
+
+  const RegionType & traversalRegion = chunk.m_TraversalRegion;
+
+  std::fill(chunk.m_SymmetricEntries.begin(), chunk.m_SymmetricEntries.end(), noSymmetricEntry);
+  std::fill(chunk.m_IsForwardSearchOffset.begin(), chunk.m_IsForwardSearchOffset.end(), false);
+  chunk.m_NumberOfSymmetricEntries = 0;
+  chunk.m_NumberOfSymmetricSlots = 1;
+
+  for (unsigned int m = 0; chunk.m_UseSymmetricDistances && m < chunk.m_NeighborhoodSearchSize; m++)
+  {
+    const NeighborhoodOffsetType offset = chunk.m_NeighborhoodSearchOffsetList[m];
+
+    // The last non-zero component gives the direction in raster order, and
+    // an offset longer than the region never has both voxels inside it.
+    int             direction = 0;
+    bool            fitsRegion = true;
+    OffsetValueType rasterStep = 0;
+    for (int d = ImageDimension - 1; d >= 0; d--)
+    {
+      direction = direction != 0 ? direction : (offset[d] > 0) - (offset[d] < 0);
+      fitsRegion = fitsRegion && static_cast<SizeValueType>(std::abs(offset[d])) < traversalRegion.GetSize(d);
+      rasterStep = rasterStep * static_cast<OffsetValueType>(traversalRegion.GetSize(d)) + offset[d];
+    }
+    if (direction <= 0 || !fitsRegion || chunk.m_OppositeSearchOffsets[m] == noSymmetricEntry)
+    {
+      continue;
+    }
+    chunk.m_IsForwardSearchOffset[m] = true;
+    chunk.m_ForwardRasterSteps[m] = static_cast<SizeValueType>(rasterStep);
+    chunk.m_SymmetricEntries[m] = chunk.m_NumberOfSymmetricEntries;
+    chunk.m_SymmetricEntries[chunk.m_OppositeSearchOffsets[m]] = chunk.m_NumberOfSymmetricEntries;
+    chunk.m_NumberOfSymmetricEntries++;
+    chunk.m_NumberOfSymmetricSlots = std::max(chunk.m_NumberOfSymmetricSlots, chunk.m_ForwardRasterSteps[m] + 1);
+  }
+  chunk.m_NumberOfSymmetricSlots = std::min(chunk.m_NumberOfSymmetricSlots, traversalRegion.GetNumberOfPixels());
+
+  chunk.m_SymmetricDistances.assign(chunk.m_NumberOfSymmetricSlots * chunk.m_NumberOfSymmetricEntries,
+                                    noSymmetricDistance);
+  chunk.m_CenterPosition = 0;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::RecycleSymmetricPatchDistanceSlot(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  // The slot of the previous voxel may now receive the distances of the voxel
+  // which follows it by the whole ring.
+  if (chunk.m_NumberOfSymmetricEntries > 0 && chunk.m_CenterPosition > 0)
+  {
+    const SizeValueType slot = (chunk.m_CenterPosition - 1) % chunk.m_NumberOfSymmetricSlots;
+    for (unsigned int entry = 0; entry < chunk.m_NumberOfSymmetricEntries; entry++)
+    {
+      chunk.m_SymmetricDistances[entry * chunk.m_NumberOfSymmetricSlots + slot] =
+        NumericTraits<RealType>::NonpositiveMin();
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GatherTileStatistics(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  typedef typename DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel>::AuxiliaryImageType AuxiliaryImageType;
+
+  chunk.m_TileStatisticsRegion = chunk.m_TraversalRegion;
+  chunk.m_TileStatisticsRegion.PadByRadius(chunk.m_NeighborhoodSearchExtent);
+  chunk.m_TileStatisticsRegion.Crop(chunk.m_SearchImageRegion);
+
+  chunk.m_TileStatistics.resize(chunk.m_TileStatisticsRegion.GetNumberOfPixels());
+  ImageRegionConstIterator<InputImageType>     ItI(chunk.m_InputImage, chunk.m_TileStatisticsRegion);
+  ImageRegionConstIterator<AuxiliaryImageType> ItMean(chunk.m_MeanImage, chunk.m_TileStatisticsRegion);
+  ImageRegionConstIterator<AuxiliaryImageType> ItV(chunk.m_VarianceImage, chunk.m_TileStatisticsRegion);
+  for (NeighborStatistics & statistics : chunk.m_TileStatistics)
+  {
+    statistics.m_Input = ItI.Get();
+    statistics.m_Mean = ConvertToReal(ItMean.Get()) * chunk.m_MeanScale;
+    statistics.m_Variance = ConvertToReal(ItV.Get()) * chunk.m_VarianceScale;
+    ++ItI;
+    ++ItMean;
+    ++ItV;
+  }
+
+  for (unsigned int m = 0; m < chunk.m_NeighborhoodSearchSize; m++)
+  {
+    OffsetValueType offset = 0;
+    OffsetValueType stride = 1;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      offset += chunk.m_NeighborhoodSearchOffsetList[m][d] * stride;
+      stride *= static_cast<OffsetValueType>(chunk.m_TileStatisticsRegion.GetSize(d));
+    }
+    chunk.m_TileStatisticsSearchOffsets[m] = offset;
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SetUpDirectDistanceCenter(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  const IndexType &                                    centerIndex) const
+{
+  chunk.m_CenterIndex = centerIndex;
+  chunk.m_IsInteriorCenter = chunk.m_InteriorRegion.IsInside(centerIndex);
+  chunk.m_InputCenterOffset = chunk.m_InputImage->ComputeOffset(centerIndex);
+  chunk.m_ResidualCenterOffset = chunk.m_ResidualImage->ComputeOffset(centerIndex);
+  chunk.m_AccumulatorCenterOffset = chunk.m_Accumulator->m_EstimateImages[0]->ComputeOffset(centerIndex);
+  for (unsigned int c = 0; c < chunk.m_NumberOfChannels; c++)
+  {
+    chunk.m_ChannelCenterOffsets[c] = chunk.m_ChannelImages[c]->ComputeOffset(centerIndex);
+  }
+
+  chunk.m_MeanCenterOffset = chunk.m_MeanImage->ComputeOffset(centerIndex);
+  chunk.m_VarianceCenterOffset = chunk.m_VarianceImage->ComputeOffset(centerIndex);
+  chunk.m_TileStatisticsCenterOffset =
+    chunk.m_UseTileStatistics
+      ? static_cast<OffsetValueType>(ComputeRegionPosition(chunk.m_TileStatisticsRegion, centerIndex))
+      : 0;
+
+  chunk.m_InputCenterPixel = chunk.m_InputBuffer[chunk.m_InputCenterOffset];
+  chunk.m_MeanCenterPixel = ConvertToReal(chunk.m_MeanBuffer[chunk.m_MeanCenterOffset]) * chunk.m_MeanScale;
+  chunk.m_VarianceCenterPixel =
+    ConvertToReal(chunk.m_VarianceBuffer[chunk.m_VarianceCenterOffset]) * chunk.m_VarianceScale;
+
+  std::fill(chunk.m_MaxWeights.begin(), chunk.m_MaxWeights.end(), NumericTraits<RealType>::ZeroValue());
+  std::fill(chunk.m_SumsOfWeights.begin(), chunk.m_SumsOfWeights.end(), NumericTraits<RealType>::ZeroValue());
+
+  std::fill(chunk.m_WeightedAverageIntensities,
+            chunk.m_WeightedAverageIntensities + chunk.m_NumberOfOutputs * chunk.m_NeighborhoodPatchSize,
+            NumericTraits<RealType>::ZeroValue());
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SelectCellSearchOffsets(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  const IndexType &                                    cellIndex) const
+{
+  if (chunk.m_HasSearchOffsetsCell && cellIndex == chunk.m_SearchOffsetsCellIndex)
+  {
+    return;
+  }
+  chunk.m_HasSearchOffsetsCell = true;
+  chunk.m_SearchOffsetsCellIndex = cellIndex;
+
+  const SizeValueType cellPosition = ComputeRegionPosition(chunk.m_CellRegion, cellIndex);
+
+  chunk.m_SearchOffsets.clear();
+  for (unsigned int k = 0; k < this->m_NumberOfCoarseSearchCandidates; k++)
+  {
+    const unsigned int j = chunk.m_CellCandidates[cellPosition * this->m_NumberOfCoarseSearchCandidates + k];
+    if (j == NumericTraits<unsigned int>::max())
+    {
+      break;
+    }
+    for (const unsigned int m : this->m_CoarseToFineSearchOffsets[j])
+    {
+      if (!chunk.m_IsSearchOffset[m])
+      {
+        chunk.m_IsSearchOffset[m] = true;
+        chunk.m_SearchOffsets.push_back(m);
+      }
+    }
+  }
+  std::sort(chunk.m_SearchOffsets.begin(), chunk.m_SearchOffsets.end());
+  for (const unsigned int m : chunk.m_SearchOffsets)
+  {
+    chunk.m_IsSearchOffset[m] = false;
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SelectPatchMatchNeighbors(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  const SizeValueType * neighbors =
+    this->m_PatchMatchNeighbors.data() +
+    ComputeRegionPosition(this->m_PatchMatchRegion, chunk.m_CenterIndex) * chunk.m_NumberOfPatchMatchNeighbors;
+
+  NeighborhoodOffsetListType & neighborhoodSearchOffsetList = chunk.m_NeighborhoodSearchOffsetList;
+
+  neighborhoodSearchOffsetList.clear();
+  for (SizeValueType k = 0;
+       k < chunk.m_NumberOfPatchMatchNeighbors && neighbors[k] != NumericTraits<SizeValueType>::max();
+       k++)
+  {
+    const IndexType neighborIndex = ComputeRegionIndex(chunk.m_TargetImageRegion, neighbors[k]);
+    neighborhoodSearchOffsetList.push_back(neighborIndex - chunk.m_CenterIndex);
+    chunk.m_IsInteriorCenter = chunk.m_IsInteriorCenter && chunk.m_PatchInteriorRegion.IsInside(neighborIndex);
+  }
+  neighborhoodSearchOffsetList.push_back(NeighborhoodOffsetType{});
+
+  chunk.m_NeighborhoodSearchSize = static_cast<unsigned int>(neighborhoodSearchOffsetList.size());
+  chunk.m_CenterSearchOffset = chunk.m_NeighborhoodSearchSize - 1;
+  chunk.m_SearchOffsets.resize(chunk.m_NeighborhoodSearchSize);
+  std::iota(chunk.m_SearchOffsets.begin(), chunk.m_SearchOffsets.end(), 0u);
+
+  chunk.m_InputSearchOffsets = ComputeBufferOffsets(chunk.m_InputImage, neighborhoodSearchOffsetList);
+  chunk.m_MeanSearchOffsets = ComputeBufferOffsets(chunk.m_MeanImage, neighborhoodSearchOffsetList);
+  chunk.m_VarianceSearchOffsets = ComputeBufferOffsets(chunk.m_VarianceImage, neighborhoodSearchOffsetList);
+  chunk.m_ResidualSearchOffsets = ComputeBufferOffsets(chunk.m_ResidualImage, neighborhoodSearchOffsetList);
+  for (unsigned int c = 0; c < chunk.m_NumberOfChannels; c++)
+  {
+    chunk.m_ChannelSearchOffsets[c] = ComputeBufferOffsets(chunk.m_ChannelImages[c], neighborhoodSearchOffsetList);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeMinimumDistances(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  // The preselected neighbors are gathered while searching for the minimum
+  // distance so that the weighting pass does not repeat the tests.
+  chunk.m_CandidateSearchOffsets.clear();
+  chunk.m_CandidatePreselections.clear();
+
+  std::fill(chunk.m_MinimumDistances.begin(), chunk.m_MinimumDistances.end(), NumericTraits<RealType>::max());
+  for (const unsigned int m : chunk.m_SearchOffsets)
+  {
+    if (m == chunk.m_CenterSearchOffset ||
+        (!chunk.m_IsInteriorCenter &&
+         !chunk.m_SearchImageRegion.IsInside(chunk.m_CenterIndex + chunk.m_NeighborhoodSearchOffsetList[m])))
+    {
+      continue;
+    }
+
+    NeighborStatistics neighborStatistics;
+    if (chunk.m_UseTileStatistics)
+    {
+      neighborStatistics =
+        chunk.m_TileStatistics[chunk.m_TileStatisticsCenterOffset + chunk.m_TileStatisticsSearchOffsets[m]];
+    }
+    else
+    {
+      neighborStatistics.m_Input = chunk.m_InputBuffer[chunk.m_InputCenterOffset + chunk.m_InputSearchOffsets[m]];
+      neighborStatistics.m_Mean =
+        ConvertToReal(chunk.m_MeanBuffer[chunk.m_MeanCenterOffset + chunk.m_MeanSearchOffsets[m]]) * chunk.m_MeanScale;
+      neighborStatistics.m_Variance =
+        ConvertToReal(chunk.m_VarianceBuffer[chunk.m_VarianceCenterOffset + chunk.m_VarianceSearchOffsets[m]]) *
+        chunk.m_VarianceScale;
+    }
+
+    bool isPreselected = false;
+    for (unsigned int s = 0; s < chunk.m_NumberOfParameterSets; s++)
+    {
+      chunk.m_IsPreselectedBySet[s] = this->IsNeighborPreselected(chunk.m_MeanCenterPixel,
+                                                                  chunk.m_VarianceCenterPixel,
+                                                                  neighborStatistics.m_Input,
+                                                                  neighborStatistics.m_Mean,
+                                                                  neighborStatistics.m_Variance,
+                                                                  chunk.m_ParameterSets[s]);
+      isPreselected = isPreselected || chunk.m_IsPreselectedBySet[s];
+    }
+
+    if (isPreselected)
+    {
+      chunk.m_CandidateSearchOffsets.push_back(m);
+      chunk.m_CandidatePreselections.insert(
+        chunk.m_CandidatePreselections.end(), chunk.m_IsPreselectedBySet.begin(), chunk.m_IsPreselectedBySet.end());
+
+      for (unsigned int c = 0; c < chunk.m_NumberOfDistanceChannels; c++)
+      {
+        RealType averageDistance;
+        RealType count;
+        this->ComputeSquaredNorm(chunk, c, m, averageDistance, count);
+
+        averageDistance /= count;
+        for (unsigned int s = 0; s < chunk.m_NumberOfParameterSets; s++)
+        {
+          RealType & minimumDistance = chunk.m_MinimumDistances[s * chunk.m_NumberOfDistanceChannels + c];
+          if (chunk.m_IsPreselectedBySet[s])
+          {
+            minimumDistance = std::min(averageDistance, minimumDistance);
+          }
+        }
+      }
+    }
+  }
+
+  for (auto & channelMinimumDistance : chunk.m_MinimumDistances)
+  {
+    if (itk::Math::AlmostEquals(channelMinimumDistance, NumericTraits<RealType>::ZeroValue()))
+    {
+      channelMinimumDistance = NumericTraits<RealType>::OneValue();
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::StoreRicianBiases(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  std::vector<SizeValueType> & ricianBiasPositions = chunk.m_RicianBiasPositions;
+
+  for (unsigned int b = 0; b < chunk.m_NumberOfParameterSets * chunk.m_NumberOfBiasChannels; b++)
+  {
+    RealType bias = chunk.m_MinimumDistances[b];
+    if (itk::Math::AlmostEquals(bias, NumericTraits<RealType>::max()))
+    {
+      bias = NumericTraits<RealType>::ZeroValue();
+    }
+    RealType * ricianBiasBuffer = chunk.m_RicianBiasBuffers[b];
+    if (ricianBiasPositions.empty())
+    {
+      this->VisitCenterPatchRows(
+        chunk, [&](const SizeValueType, const SizeValueType length, const OffsetValueType offset) {
+          std::fill(ricianBiasBuffer + offset, ricianBiasBuffer + offset + length, bias);
+        });
+      continue;
+    }
+    const SizeValueType ricianBiasPosition = ComputeRegionPosition(chunk.m_Region, chunk.m_CenterIndex) + 1;
+    this->VisitCenterPatchRows(
+      chunk, [&](const SizeValueType, const SizeValueType length, const OffsetValueType offset) {
+        for (SizeValueType i = 0; i < length; i++)
+        {
+          if (ricianBiasPositions[offset + i] <= ricianBiasPosition)
+          {
+            ricianBiasPositions[offset + i] = ricianBiasPosition;
+            ricianBiasBuffer[offset + i] = bias;
+          }
+        }
+      });
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::WeightNeighbors(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  const unsigned int numberOfParameterSets = chunk.m_NumberOfParameterSets;
+
+  for (unsigned int s = 0; s < numberOfParameterSets; s++)
+  {
+    chunk.m_CutoffDistances[s] =
+      static_cast<RealType>(3.0) * chunk.m_MinimumDistances[s * chunk.m_NumberOfDistanceChannels];
+  }
+
+  // The correlation dissimilarities are scaled by twice the variance of the
+  // residual patch of the center.
+  RealType correlationDistanceScale = NumericTraits<RealType>::ZeroValue();
+  if (chunk.m_UsePearsonCorrelation && chunk.m_PatchInverseStandardDeviationBuffer[chunk.m_ResidualCenterOffset] > 0)
+  {
+    correlationDistanceScale =
+      static_cast<RealType>(2.0) /
+      itk::Math::sqr(chunk.m_PatchInverseStandardDeviationBuffer[chunk.m_ResidualCenterOffset]);
+  }
+
+  // A sum beyond this bound gives an average distance above the cutoff of
+  // every parameter set once rounded, so the neighbor gets no weight.  The
+  // margin covers the rounding of the division.
+  RealType maximumSum = NumericTraits<RealType>::max();
+  if (this->m_UsePatchDistanceEarlyTermination && !chunk.m_UsePearsonCorrelation)
+  {
+    const RealType cutoffDistance = *std::max_element(chunk.m_CutoffDistances.begin(), chunk.m_CutoffDistances.end());
+    maximumSum = static_cast<RealType>(static_cast<double>(cutoffDistance) *
+                                       static_cast<double>(chunk.m_NeighborhoodPatchSize) *
+                                       (1.0 + 4.0 * NumericTraits<RealType>::epsilon()));
+  }
+
+  for (SizeValueType k = 0; k < chunk.m_CandidateSearchOffsets.size(); k++)
+  {
+    const unsigned int m = chunk.m_CandidateSearchOffsets[k];
+
+    RealType averageDistance;
+    if (!this->ComputeAverageDistance(chunk, m, maximumSum, averageDistance))
+    {
+      // Its weight would be zero.
+      continue;
+    }
+    if (chunk.m_UsePearsonCorrelation)
+    {
+      averageDistance *= correlationDistanceScale;
+    }
+
+    for (unsigned int s = 0; s < numberOfParameterSets; s++)
+    {
+      if (!chunk.m_CandidatePreselections[k * numberOfParameterSets + s])
+      {
+        continue;
+      }
+
+      RealType weight = itk::NumericTraits<RealType>::ZeroValue();
+      if (averageDistance <= chunk.m_CutoffDistances[s])
+      {
+        weight = std::exp(-averageDistance / (chunk.m_ParameterSets[s].m_SmoothingFactor *
+                                              chunk.m_MinimumDistances[s * chunk.m_NumberOfDistanceChannels]));
+      }
+      if (weight > chunk.m_MaxWeights[s])
+      {
+        chunk.m_MaxWeights[s] = weight;
+      }
+
+      if (weight > itk::NumericTraits<RealType>::ZeroValue())
+      {
+        this->AccumulateWeightedIntensities(chunk, s, m, weight);
+        chunk.m_SumsOfWeights[s] += weight;
+      }
+    }
+  }
+
+  for (auto & maxWeight : chunk.m_MaxWeights)
+  {
+    if (itk::Math::AlmostEquals(maxWeight, NumericTraits<RealType>::ZeroValue()))
+    {
+      maxWeight = NumericTraits<RealType>::OneValue();
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::AccumulateCenterEstimates(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk) const
+{
+  for (unsigned int s = 0; s < chunk.m_NumberOfParameterSets; s++)
+  {
+    this->AccumulateWeightedIntensities(chunk, s, chunk.m_CenterSearchOffset, chunk.m_MaxWeights[s]);
+    chunk.m_SumsOfWeights[s] += chunk.m_MaxWeights[s];
+
+    if (chunk.m_SumsOfWeights[s] > itk::NumericTraits<RealType>::ZeroValue())
+    {
+      for (unsigned int c = 0; c < chunk.m_NumberOfChannels; c++)
+      {
+        const unsigned int o = s * chunk.m_NumberOfChannels + c;
+
+        RealType *       estimateBuffer = chunk.m_EstimateBuffers[o];
+        const RealType * weightedChannelIntensities =
+          chunk.m_WeightedAverageIntensities + o * chunk.m_NeighborhoodPatchSize;
+        const RealType sumOfWeights = chunk.m_SumsOfWeights[s];
+        this->VisitCenterPatchRows(
+          chunk, [&](const SizeValueType n, const SizeValueType length, const OffsetValueType offset) {
+            for (SizeValueType i = 0; i < length; i++)
+            {
+              estimateBuffer[offset + i] += weightedChannelIntensities[n + i] / sumOfWeights;
+            }
+          });
+      }
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeAverageDistance(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  const unsigned int                                   m,
+  const RealType                                       maximumSum,
+  RealType &                                           averageDistance) const
+{
+  const unsigned int noSymmetricEntry = NumericTraits<unsigned int>::max();
+  const RealType     noSymmetricDistance = NumericTraits<RealType>::NonpositiveMin();
+
+  // Both the center and the neighbor must lie in the traversed region.  A
+  // stored value is the average distance or, if the computation stopped
+  // early, the opposite of the partial sum, which is a lower bound on the sum
+  // and lets the neighbor reject the pair against its own bound.  Such a pair
+  // always lies in the interior, where the neighbor would stop early too or
+  // find a distance beyond its cutoff.
+  RealType * storedDistance = nullptr;
+  if (chunk.m_UseSymmetricDistances && chunk.m_SymmetricEntries[m] != noSymmetricEntry &&
+      chunk.m_TraversalRegion.IsInside(chunk.m_CenterIndex + chunk.m_NeighborhoodSearchOffsetList[m]))
+  {
+    const SizeValueType entryOffset = chunk.m_SymmetricEntries[m] * chunk.m_NumberOfSymmetricSlots;
+    if (!chunk.m_IsForwardSearchOffset[m])
+    {
+      averageDistance =
+        chunk.m_SymmetricDistances[entryOffset + chunk.m_CenterPosition % chunk.m_NumberOfSymmetricSlots];
+      if (averageDistance >= NumericTraits<RealType>::ZeroValue())
+      {
+        return true;
+      }
+      if (averageDistance > noSymmetricDistance && -averageDistance > maximumSum)
+      {
+        return false;
+      }
+    }
+    else
+    {
+      storedDistance = chunk.m_SymmetricDistances.data() + entryOffset +
+                       (chunk.m_CenterPosition + chunk.m_ForwardRasterSteps[m]) % chunk.m_NumberOfSymmetricSlots;
+    }
+  }
+
+  RealType count;
+  if (chunk.m_UsePearsonCorrelation)
+  {
+    this->ComputeCenteredProducts(chunk, m, averageDistance, count);
+    averageDistance = ComputeCorrelationDissimilarity(
+      averageDistance / count,
+      chunk.m_PatchInverseStandardDeviationBuffer[chunk.m_ResidualCenterOffset],
+      chunk.m_PatchInverseStandardDeviationBuffer[chunk.m_ResidualCenterOffset + chunk.m_ResidualSearchOffsets[m]]);
+  }
+  else if (!this->ComputeSquaredDistance(chunk, m, maximumSum, averageDistance, count))
+  {
+    if (storedDistance)
+    {
+      *storedDistance = -averageDistance;
+    }
+    return false;
+  }
+  else
+  {
+    averageDistance /= count;
+  }
+  if (storedDistance)
+  {
+    *storedDistance = averageDistance;
+  }
+  return true;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeSquaredNorm(
+  const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  const unsigned int                                         c,
+  const unsigned int                                         m,
+  RealType &                                                 sum,
+  RealType &                                                 count) const
+{
+  typedef DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> ChunkType;
+
+  const TAuxiliaryPixel * residualBuffer = chunk.m_ResidualBuffers[c];
+
+  sum = NumericTraits<RealType>::ZeroValue();
+  count = NumericTraits<RealType>::ZeroValue();
+  if (chunk.m_IsInteriorCenter)
+  {
+    const TAuxiliaryPixel * patch = residualBuffer + chunk.m_ResidualCenterOffset + chunk.m_ResidualSearchOffsets[m];
+    for (SizeValueType row = 0; row < chunk.m_NumberOfRows; row++)
+    {
+      sum += SumOfSquares<ChunkType::FixedRowLength>(patch + chunk.m_ResidualRowOffsets[row], chunk.m_RowLength);
+    }
+    sum *= chunk.m_SquaredResidualScales[c];
+    count = static_cast<RealType>(chunk.m_NeighborhoodPatchSize);
+    return;
+  }
+  const IndexType neighborhoodIndex = chunk.m_CenterIndex + chunk.m_NeighborhoodSearchOffsetList[m];
+  this->VisitPatchRows(
+    neighborhoodIndex,
+    neighborhoodIndex,
+    [&](const SizeValueType, const SizeValueType length, const IndexType & rowIndex, const IndexType &) {
+      sum += SumOfSquares<0>(residualBuffer + chunk.m_ResidualImage->ComputeOffset(rowIndex), length);
+      count += static_cast<RealType>(length);
+    });
+  sum *= chunk.m_SquaredResidualScales[c];
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+bool
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeSquaredDistance(
+  const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  const unsigned int                                         m,
+  const RealType                                             maximumSum,
+  RealType &                                                 sum,
+  RealType &                                                 count) const
+{
+  typedef DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> ChunkType;
+
+  const TAuxiliaryPixel * residualBuffer = chunk.m_ResidualBuffers[0];
+
+  // The bound applies to the sum of a whole interior patch.  The partial sums
+  // of squares never decrease, even in floating point.
+  sum = NumericTraits<RealType>::ZeroValue();
+  count = NumericTraits<RealType>::ZeroValue();
+  if (chunk.m_IsInteriorCenter)
+  {
+    const RealType          maximumScaledSum = maximumSum / chunk.m_SquaredResidualScales[0];
+    const TAuxiliaryPixel * centerPatch = residualBuffer + chunk.m_ResidualCenterOffset;
+    const TAuxiliaryPixel * searchPatch = centerPatch + chunk.m_ResidualSearchOffsets[m];
+    for (SizeValueType row = 0; row < chunk.m_NumberOfRows; row++)
+    {
+      sum += SumOfSquaredDifferences<ChunkType::FixedRowLength>(searchPatch + chunk.m_ResidualRowOffsets[row],
+                                                                centerPatch + chunk.m_ResidualRowOffsets[row],
+                                                                chunk.m_RowLength);
+      if (sum > maximumScaledSum)
+      {
+        sum *= chunk.m_SquaredResidualScales[0];
+        return false;
+      }
+    }
+    sum *= chunk.m_SquaredResidualScales[0];
+    count = static_cast<RealType>(chunk.m_NeighborhoodPatchSize);
+    return true;
+  }
+  this->VisitPatchRows(chunk.m_CenterIndex + chunk.m_NeighborhoodSearchOffsetList[m],
+                       chunk.m_CenterIndex,
+                       [&](const SizeValueType,
+                           const SizeValueType length,
+                           const IndexType &   searchRowIndex,
+                           const IndexType &   centerRowIndex) {
+                         sum += SumOfSquaredDifferences<0>(
+                           residualBuffer + chunk.m_ResidualImage->ComputeOffset(searchRowIndex),
+                           residualBuffer + chunk.m_ResidualImage->ComputeOffset(centerRowIndex),
+                           length);
+                         count += static_cast<RealType>(length);
+                       });
+  sum *= chunk.m_SquaredResidualScales[0];
+  return true;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeCenteredProducts(
+  const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  const unsigned int                                         m,
+  RealType &                                                 sum,
+  RealType &                                                 count) const
+{
+  typedef DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> ChunkType;
+
+  const TAuxiliaryPixel * residualBuffer = chunk.m_ResidualBuffers[0];
+  const RealType          centerMean = chunk.m_PatchMeanBuffer[chunk.m_ResidualCenterOffset] / chunk.m_ResidualScale;
+  const RealType          searchMean =
+    chunk.m_PatchMeanBuffer[chunk.m_ResidualCenterOffset + chunk.m_ResidualSearchOffsets[m]] / chunk.m_ResidualScale;
+
+  sum = NumericTraits<RealType>::ZeroValue();
+  count = NumericTraits<RealType>::ZeroValue();
+  if (chunk.m_IsInteriorCenter)
+  {
+    const TAuxiliaryPixel * centerPatch = residualBuffer + chunk.m_ResidualCenterOffset;
+    const TAuxiliaryPixel * searchPatch = centerPatch + chunk.m_ResidualSearchOffsets[m];
+    for (SizeValueType row = 0; row < chunk.m_NumberOfRows; row++)
+    {
+      sum += SumOfCenteredProducts<ChunkType::FixedRowLength>(searchPatch + chunk.m_ResidualRowOffsets[row],
+                                                              searchMean,
+                                                              centerPatch + chunk.m_ResidualRowOffsets[row],
+                                                              centerMean,
+                                                              chunk.m_RowLength);
+    }
+    sum *= chunk.m_SquaredResidualScales[0];
+    count = static_cast<RealType>(chunk.m_NeighborhoodPatchSize);
+    return;
+  }
+  this->VisitPatchRows(chunk.m_CenterIndex + chunk.m_NeighborhoodSearchOffsetList[m],
+                       chunk.m_CenterIndex,
+                       [&](const SizeValueType,
+                           const SizeValueType length,
+                           const IndexType &   searchRowIndex,
+                           const IndexType &   centerRowIndex) {
+                         sum += SumOfCenteredProducts<0>(
+                           residualBuffer + chunk.m_ResidualImage->ComputeOffset(searchRowIndex),
+                           searchMean,
+                           residualBuffer + chunk.m_ResidualImage->ComputeOffset(centerRowIndex),
+                           centerMean,
+                           length);
+                         count += static_cast<RealType>(length);
+                       });
+  sum *= chunk.m_SquaredResidualScales[0];
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::AccumulateWeightedIntensities(
+  DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  const unsigned int                                   s,
+  const unsigned int                                   m,
+  const RealType                                       weight) const
+{
+  typedef DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> ChunkType;
+
+  for (unsigned int c = 0; c < chunk.m_NumberOfChannels; c++)
+  {
+    RealType * weightedChannelIntensities =
+      chunk.m_WeightedAverageIntensities + (s * chunk.m_NumberOfChannels + c) * chunk.m_NeighborhoodPatchSize;
+    if (chunk.m_IsInteriorCenter)
+    {
+      const InputPixelType * patch =
+        chunk.m_ChannelBuffers[c] + chunk.m_ChannelCenterOffsets[c] + chunk.m_ChannelSearchOffsets[c][m];
+      for (SizeValueType row = 0; row < chunk.m_NumberOfRows; row++)
+      {
+        AccumulateWeightedRow<ChunkType::FixedRowLength>(weightedChannelIntensities + row * chunk.m_RowLength,
+                                                         patch + chunk.m_ChannelRowOffsets[c][row],
+                                                         chunk.m_RowLength,
+                                                         weight,
+                                                         this->m_UseRicianNoiseModel);
+      }
+      continue;
+    }
+    const IndexType neighborhoodIndex = chunk.m_CenterIndex + chunk.m_NeighborhoodSearchOffsetList[m];
+    this->VisitPatchRows(
+      neighborhoodIndex,
+      neighborhoodIndex,
+      [&](const SizeValueType n, const SizeValueType length, const IndexType & rowIndex, const IndexType &) {
+        AccumulateWeightedRow<0>(weightedChannelIntensities + n,
+                                 chunk.m_ChannelBuffers[c] + chunk.m_ChannelImages[c]->ComputeOffset(rowIndex),
+                                 length,
+                                 weight,
+                                 this->m_UseRicianNoiseModel);
+      });
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <unsigned int VPatchRadius, typename TAuxiliaryPixel, typename TRowFunction>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::VisitCenterPatchRows(
+  const DirectDistanceChunk<VPatchRadius, TAuxiliaryPixel> & chunk,
+  TRowFunction &&                                            rowFunction) const
+{
+  if (chunk.m_IsInteriorCenter)
+  {
+    for (SizeValueType row = 0; row < chunk.m_NumberOfRows; row++)
+    {
+      rowFunction(row * chunk.m_RowLength,
+                  chunk.m_RowLength,
+                  chunk.m_AccumulatorCenterOffset + chunk.m_AccumulatorRowOffsets[row]);
+    }
+    return;
+  }
+  this->VisitPatchRows(
+    chunk.m_CenterIndex,
+    chunk.m_CenterIndex,
+    [&](const SizeValueType n, const SizeValueType length, const IndexType & rowIndex, const IndexType &) {
+      rowFunction(n, length, chunk.m_Accumulator->m_EstimateImages[0]->ComputeOffset(rowIndex));
+    });
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <typename TRowFunction>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::VisitPatchRows(
+  const IndexType & index1,
+  const IndexType & index2,
+  TRowFunction &&   rowFunction) const
+{
+  const RegionType &             targetImageRegion = this->m_TargetImageRegion;
+  const NeighborhoodRadiusType & radius = this->m_NeighborhoodPatchRadius;
+
+  // Along the first axis every row is clipped identically, so the span of
+  // patch positions inside the target region is computed once.
+
+  const IndexValueType rowLength = 2 * static_cast<IndexValueType>(radius[0]) + 1;
+  const IndexValueType targetBegin = targetImageRegion.GetIndex(0);
+  const IndexValueType targetEnd = targetBegin + static_cast<IndexValueType>(targetImageRegion.GetSize(0));
+  const IndexValueType rowStart1 = index1[0] - static_cast<IndexValueType>(radius[0]);
+  const IndexValueType rowStart2 = index2[0] - static_cast<IndexValueType>(radius[0]);
+
+  const IndexValueType spanBegin =
+    std::max(std::max(IndexValueType{ 0 }, targetBegin - rowStart1), targetBegin - rowStart2);
+  const IndexValueType spanEnd = std::min(std::min(rowLength, targetEnd - rowStart1), targetEnd - rowStart2);
+  if (spanBegin >= spanEnd)
+  {
+    return;
+  }
+  const SizeValueType spanLength = static_cast<SizeValueType>(spanEnd - spanBegin);
+
+  IndexType rowIndex1;
+  IndexType rowIndex2;
+  rowIndex1[0] = rowStart1 + spanBegin;
+  rowIndex2[0] = rowStart2 + spanBegin;
+  for (unsigned int d = 1; d < ImageDimension; d++)
+  {
+    rowIndex1[d] = index1[d] - static_cast<IndexValueType>(radius[d]);
+    rowIndex2[d] = index2[d] - static_cast<IndexValueType>(radius[d]);
+  }
+
+  const SizeValueType numberOfRows = this->m_NeighborhoodPatchSize / static_cast<SizeValueType>(rowLength);
+  for (SizeValueType row = 0; row < numberOfRows; row++)
+  {
+    bool isInside = true;
+    for (unsigned int d = 1; d < ImageDimension; d++)
+    {
+      const IndexValueType begin = targetImageRegion.GetIndex(d);
+      const IndexValueType end = begin + static_cast<IndexValueType>(targetImageRegion.GetSize(d));
+      if (rowIndex1[d] < begin || rowIndex1[d] >= end || rowIndex2[d] < begin || rowIndex2[d] >= end)
+      {
+        isInside = false;
+        break;
+      }
+    }
+    if (isInside)
+    {
+      rowFunction(row * static_cast<SizeValueType>(rowLength) + static_cast<SizeValueType>(spanBegin),
+                  spanLength,
+                  rowIndex1,
+                  rowIndex2);
+    }
+
+    // Move to the next row of the patches.
+    for (unsigned int d = 1; d < ImageDimension; d++)
+    {
+      if (rowIndex1[d] < index1[d] + static_cast<IndexValueType>(radius[d]))
+      {
+        ++rowIndex1[d];
+        ++rowIndex2[d];
+        break;
+      }
+      rowIndex1[d] = index1[d] - static_cast<IndexValueType>(radius[d]);
+      rowIndex2[d] = index2[d] - static_cast<IndexValueType>(radius[d]);
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <SizeValueType VLength, typename TPixel>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SumOfSquares(
+  const TPixel *      row,
+  const SizeValueType length) -> RealType
+{
+  const SizeValueType rowLength = VLength > 0 ? VLength : length;
+
+  RealType sum = NumericTraits<RealType>::ZeroValue();
+  for (SizeValueType i = 0; i < rowLength; i++)
+  {
+    const RealType value = ConvertToReal(row[i]);
+    sum += value * value;
+  }
+  return sum;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <SizeValueType VLength, typename TPixel>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SumOfSquaredDifferences(
+  const TPixel *      row1,
+  const TPixel *      row2,
+  const SizeValueType length) -> RealType
+{
+  const SizeValueType rowLength = VLength > 0 ? VLength : length;
+
+  RealType sum = NumericTraits<RealType>::ZeroValue();
+  for (SizeValueType i = 0; i < rowLength; i++)
+  {
+    const RealType difference = ConvertToReal(row1[i]) - ConvertToReal(row2[i]);
+    sum += difference * difference;
+  }
+  return sum;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <SizeValueType VLength, typename TPixel>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SumOfCenteredProducts(
+  const TPixel *      row1,
+  const RealType      mean1,
+  const TPixel *      row2,
+  const RealType      mean2,
+  const SizeValueType length) -> RealType
+{
+  const SizeValueType rowLength = VLength > 0 ? VLength : length;
+
+  RealType sum = NumericTraits<RealType>::ZeroValue();
+  for (SizeValueType i = 0; i < rowLength; i++)
+  {
+    sum += (ConvertToReal(row1[i]) - mean1) * (ConvertToReal(row2[i]) - mean2);
+  }
+  return sum;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <SizeValueType VLength>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::AccumulateWeightedRow(
+  RealType *             weightedRow,
+  const InputPixelType * row,
+  const SizeValueType    length,
+  const RealType         weight,
+  const bool             squareIntensities)
+{
+  const SizeValueType rowLength = VLength > 0 ? VLength : length;
+  if (squareIntensities)
+  {
+    for (SizeValueType i = 0; i < rowLength; i++)
+    {
+      const RealType intensity = static_cast<RealType>(row[i]);
+      weightedRow[i] += weight * (intensity * intensity);
+    }
+  }
+  else
+  {
+    for (SizeValueType i = 0; i < rowLength; i++)
+    {
+      weightedRow[i] += weight * static_cast<RealType>(row[i]);
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+template <typename TImage>
+std::vector<OffsetValueType>
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeBufferOffsets(
+  const TImage *                     image,
+  const NeighborhoodOffsetListType & offsetList)
+{
+  const OffsetValueType * offsetTable = image->GetOffsetTable();
+
+  std::vector<OffsetValueType> bufferOffsets;
+  bufferOffsets.reserve(offsetList.size());
+  for (const auto & offset : offsetList)
+  {
+    OffsetValueType bufferOffset = 0;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      bufferOffset += offset[d] * offsetTable[d];
+    }
+    bufferOffsets.push_back(bufferOffset);
+  }
+  return bufferOffsets;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ConvertToHalf(const RealType value)
+  -> HalfType
+{
+  // The fraction of a normal value is rounded by adding half a unit of the
+  // last place of the half precision fraction (minus one, plus its lowest
+  // bit, for ties to even) to the single precision pattern, whose carry
+  // moves into the exponent.  The exponent bias is adjusted on the way.  A
+  // value below the smallest normal half precision value is rounded by the
+  // floating point addition of 0.5, which aligns its bits on those of a half
+  // precision subnormal.
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = bits & 0x80000000u;
+  const uint32_t magnitude = bits ^ sign;
+
+  RealType subnormal;
+  std::memcpy(&subnormal, &magnitude, sizeof(subnormal));
+  subnormal += static_cast<RealType>(0.5);
+  uint32_t subnormalBits;
+  std::memcpy(&subnormalBits, &subnormal, sizeof(subnormalBits));
+  subnormalBits -= 0x3f000000u;
+
+  const uint32_t normalBits = (magnitude - (112u << 23) + 0xfffu + ((magnitude >> 13) & 1u)) >> 13;
+
+  const uint32_t halfBits = magnitude < (113u << 23) ? subnormalBits : normalBits;
+  return static_cast<HalfType>(halfBits | (sign >> 16));
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ConvertToReal(const HalfType value)
+  -> RealType
+{
+  // The exponent and fraction move into place in a single precision pattern
+  // whose exponent lacks the difference of the biases, 112, and the
+  // multiplication by 2^112 adds it back.  It also normalizes the
+  // subnormals.
+  static constexpr RealType exponentBiasScale = 5.192296858534828e+33f; // 2^112, exact in single precision
+
+  const uint32_t halfBits = value;
+  const uint32_t bits = ((halfBits & 0x8000u) << 16) | ((halfBits & 0x7fffu) << 13);
+  RealType       real;
+  std::memcpy(&real, &bits, sizeof(real));
+  return real * exponentBiasScale;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ConvertToHalfImage(
+  const RealImageType * image,
+  RealType &            scale) const -> HalfImagePointer
+{
+  HalfImagePointer halfImage = HalfImageType::New();
+  halfImage->CopyInformation(image);
+  halfImage->SetRegions(image->GetBufferedRegion());
+  halfImage->Allocate();
+
+  // Both passes split the buffer into one contiguous block per work unit.
+  const SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+  const SizeValueType numberOfBlocks =
+    std::max(std::min(static_cast<SizeValueType>(this->GetNumberOfWorkUnits()), numberOfPixels), SizeValueType{ 1 });
+  const RealType * buffer = image->GetBufferPointer();
+  HalfType *       halfBuffer = halfImage->GetBufferPointer();
+
+  std::vector<RealType> blockMaxima(numberOfBlocks, NumericTraits<RealType>::ZeroValue());
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [buffer, numberOfPixels, numberOfBlocks, &blockMaxima](SizeValueType b) {
+      RealType maximum = NumericTraits<RealType>::ZeroValue();
+      for (SizeValueType i = numberOfPixels * b / numberOfBlocks; i < numberOfPixels * (b + 1) / numberOfBlocks; i++)
+      {
+        maximum = std::max(maximum, std::abs(buffer[i]));
+      }
+      blockMaxima[b] = maximum;
+    },
+    nullptr);
+
+  // The scale is a power of two, so scaling is exact.
+  int exponent = 0;
+  std::frexp(*std::max_element(blockMaxima.begin(), blockMaxima.end()), &exponent);
+  scale = std::ldexp(NumericTraits<RealType>::OneValue(), exponent - 15);
+  const RealType inverseScale = std::ldexp(NumericTraits<RealType>::OneValue(), 15 - exponent);
+
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [buffer, halfBuffer, numberOfPixels, numberOfBlocks, inverseScale](SizeValueType b) {
+      for (SizeValueType i = numberOfPixels * b / numberOfBlocks; i < numberOfPixels * (b + 1) / numberOfBlocks; i++)
+      {
+        halfBuffer[i] = ConvertToHalf(buffer[i] * inverseScale);
+      }
+    },
+    nullptr);
+
+  return halfImage;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ConvertToRealImage(
+  const HalfImageType * halfImage,
+  const RealType        scale) const -> RealImagePointer
+{
+  RealImagePointer image = RealImageType::New();
+  image->CopyInformation(halfImage);
+  image->SetRegions(halfImage->GetBufferedRegion());
+  image->Allocate();
+
+  const SizeValueType numberOfPixels = halfImage->GetBufferedRegion().GetNumberOfPixels();
+  const SizeValueType numberOfBlocks =
+    std::max(std::min(static_cast<SizeValueType>(this->GetNumberOfWorkUnits()), numberOfPixels), SizeValueType{ 1 });
+  const HalfType * halfBuffer = halfImage->GetBufferPointer();
+  RealType *       buffer = image->GetBufferPointer();
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [buffer, halfBuffer, numberOfPixels, numberOfBlocks, scale](SizeValueType b) {
+      for (SizeValueType i = numberOfPixels * b / numberOfBlocks; i < numberOfPixels * (b + 1) / numberOfBlocks; i++)
+      {
+        buffer[i] = ConvertToReal(halfBuffer[i]) * scale;
+      }
+    },
+    nullptr);
+
+  return image;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetAuxiliaryImages(
+  AuxiliaryImages<RealType> & images) const
+{
+  images.m_MeanImage = this->m_MeanImage;
+  images.m_VarianceImage = this->m_VarianceImage;
+  images.m_ResidualImages.assign(this->m_ChannelResidualImages.begin(), this->m_ChannelResidualImages.end());
+  images.m_MeanScale = NumericTraits<RealType>::OneValue();
+  images.m_VarianceScale = NumericTraits<RealType>::OneValue();
+  images.m_ResidualScales.assign(this->m_ChannelResidualImages.size(), NumericTraits<RealType>::OneValue());
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetAuxiliaryImages(
+  AuxiliaryImages<HalfType> & images) const
+{
+  images.m_MeanImage = this->m_HalfMeanImage;
+  images.m_VarianceImage = this->m_HalfVarianceImage;
+  images.m_ResidualImages.assign(this->m_HalfResidualImages.begin(), this->m_HalfResidualImages.end());
+  images.m_MeanScale = this->m_HalfMeanScale;
+  images.m_VarianceScale = this->m_HalfVarianceScale;
+  images.m_ResidualScales = this->m_HalfResidualScales;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+unsigned int
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::FindCenterSearchOffset(
+  const NeighborhoodOffsetListType & offsetList)
+{
+  const auto it = std::find(offsetList.begin(), offsetList.end(), NeighborhoodOffsetType{});
+  return static_cast<unsigned int>(it - offsetList.begin());
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GetCoarseSearchRadius() const
+  -> NeighborhoodRadiusType
+{
+  const NeighborhoodRadiusType neighborhoodSearchExtent = this->GetNeighborhoodSearchExtent();
+
+  NeighborhoodRadiusType coarseSearchRadius;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    coarseSearchRadius[d] = (neighborhoodSearchExtent[d] + 1) / 2;
+  }
+  return coarseSearchRadius;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeCellIndex(
+  const IndexType & index) const -> IndexType
+{
+  // The cells are anchored at the start of the target region so that they do
+  // not depend on how the image is split between threads or streamed pieces.
+  IndexType cellIndex;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    cellIndex[d] = (index[d] - this->m_TargetImageRegion.GetIndex(d)) / 2;
+  }
+  return cellIndex;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeCoarseSearchCandidates(
+  const RegionType &          region,
+  std::vector<unsigned int> & cellCandidates) const -> RegionType
+{
+  const RegionType &             targetImageRegion = this->m_TargetImageRegion;
+  const NeighborhoodRadiusType & neighborhoodPatchRadius = this->m_NeighborhoodPatchRadius;
+  const NeighborhoodRadiusType   coarseSearchRadius = this->GetCoarseSearchRadius();
+
+  // Cells of the centers of the region, of the whole target region, and of
+  // the coarse patches of their coarse neighbors.
+
+  NeighborhoodRadiusType coarsePatchRadius;
+  NeighborhoodRadiusType coarseRadius;
+  RegionType             cellRegion;
+  RegionType             gridRegion;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    coarsePatchRadius[d] = (neighborhoodPatchRadius[d] + 1) / 2;
+    coarseRadius[d] = coarseSearchRadius[d] + coarsePatchRadius[d];
+
+    const IndexValueType firstCell = this->ComputeCellIndex(region.GetIndex())[d];
+    const IndexValueType lastCell = this->ComputeCellIndex(region.GetUpperIndex())[d];
+    cellRegion.SetIndex(d, firstCell);
+    cellRegion.SetSize(d, static_cast<SizeValueType>(lastCell - firstCell + 1));
+    gridRegion.SetIndex(d, 0);
+    gridRegion.SetSize(d, (targetImageRegion.GetSize(d) + 1) / 2);
+  }
+
+  RegionType coarseRegion = cellRegion;
+  coarseRegion.PadByRadius(coarseRadius);
+  coarseRegion.Crop(gridRegion);
+
+  // Average the residuals over the cells.  The cells on the upper boundary of
+  // the target region may be incomplete.
+
+  RealImagePointer coarseResidualImage = RealImageType::New();
+  coarseResidualImage->SetRegions(coarseRegion);
+  coarseResidualImage->Allocate(true);
+
+  RegionType fineRegion;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    fineRegion.SetIndex(d, targetImageRegion.GetIndex(d) + 2 * coarseRegion.GetIndex(d));
+    fineRegion.SetSize(d, 2 * coarseRegion.GetSize(d));
+  }
+  fineRegion.Crop(targetImageRegion);
+
+  ImageRegionConstIteratorWithIndex<RealImageType> ItR(this->m_ResidualImage, fineRegion);
+  for (; !ItR.IsAtEnd(); ++ItR)
+  {
+    const IndexType cellIndex = this->ComputeCellIndex(ItR.GetIndex());
+    coarseResidualImage->SetPixel(cellIndex, coarseResidualImage->GetPixel(cellIndex) + ItR.Get());
+  }
+
+  ImageRegionIteratorWithIndex<RealImageType> ItC(coarseResidualImage, coarseRegion);
+  for (; !ItC.IsAtEnd(); ++ItC)
+  {
+    SizeValueType numberOfCellVoxels = 1;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      const IndexValueType begin = 2 * ItC.GetIndex()[d];
+      const IndexValueType end =
+        std::min(begin + 2, static_cast<IndexValueType>(targetImageRegion.GetSize(d)));
+      numberOfCellVoxels *= static_cast<SizeValueType>(end - begin);
+    }
+    ItC.Set(ItC.Get() / static_cast<RealType>(numberOfCellVoxels));
+  }
+
+  // Rank the coarse offsets of every cell by the mean squared difference of
+  // the coarse patches.  Offsets without any cell to compare come last, so
+  // that all the search offsets are kept if the number of candidates allows.
+
+  NeighborhoodType coarsePatchNeighborhood;
+  coarsePatchNeighborhood.SetRadius(coarsePatchRadius);
+
+  NeighborhoodOffsetListType coarsePatchOffsetList;
+  for (unsigned int n = 0; n < coarsePatchNeighborhood.Size(); n++)
+  {
+    coarsePatchOffsetList.push_back(coarsePatchNeighborhood.GetOffset(n));
+  }
+  const SizeValueType coarsePatchSize = coarsePatchOffsetList.size();
+
+  // The coarse patches of the cells away from the boundary of the grid, and
+  // those of all their coarse neighbors, need no bounds checking.
+
+  RegionType interiorCellRegion = gridRegion;
+  if (!interiorCellRegion.ShrinkByRadius(coarseRadius))
+  {
+    interiorCellRegion.SetSize(typename RegionType::SizeType{});
+  }
+
+  const RealType *                   coarseResidualBuffer = coarseResidualImage->GetBufferPointer();
+  const std::vector<OffsetValueType> coarseSearchBufferOffsets =
+    ComputeBufferOffsets(coarseResidualImage.GetPointer(), this->m_CoarseSearchOffsetList);
+  const std::vector<OffsetValueType> coarsePatchBufferOffsets =
+    ComputeBufferOffsets(coarseResidualImage.GetPointer(), coarsePatchOffsetList);
+
+  const unsigned int numberOfCoarseSearchOffsets = static_cast<unsigned int>(this->m_CoarseSearchOffsetList.size());
+  const unsigned int numberOfCandidates = std::min(this->m_NumberOfCoarseSearchCandidates, numberOfCoarseSearchOffsets);
+
+  cellCandidates.assign(cellRegion.GetNumberOfPixels() * this->m_NumberOfCoarseSearchCandidates,
+                        NumericTraits<unsigned int>::max());
+
+  std::vector<std::pair<RealType, unsigned int>> coarseDistances(numberOfCoarseSearchOffsets);
+
+  SizeValueType cellPosition = 0;
+
+  ImageRegionConstIteratorWithIndex<RealImageType> ItM(coarseResidualImage, cellRegion);
+  for (; !ItM.IsAtEnd(); ++ItM, cellPosition++)
+  {
+    const IndexType  cellIndex = ItM.GetIndex();
+    const RealType * centerPatch = coarseResidualBuffer + coarseResidualImage->ComputeOffset(cellIndex);
+    const bool       isInteriorCell = interiorCellRegion.IsInside(cellIndex);
+
+    for (unsigned int j = 0; j < numberOfCoarseSearchOffsets; j++)
+    {
+      const RealType * neighborPatch = centerPatch + coarseSearchBufferOffsets[j];
+      const IndexType  coarseNeighborIndex = cellIndex + this->m_CoarseSearchOffsetList[j];
+
+      RealType sum = NumericTraits<RealType>::ZeroValue();
+      RealType count = NumericTraits<RealType>::ZeroValue();
+      for (SizeValueType n = 0; n < coarsePatchSize; n++)
+      {
+        if (isInteriorCell || (gridRegion.IsInside(cellIndex + coarsePatchOffsetList[n]) &&
+                               gridRegion.IsInside(coarseNeighborIndex + coarsePatchOffsetList[n])))
+        {
+          sum += itk::Math::sqr(centerPatch[coarsePatchBufferOffsets[n]] - neighborPatch[coarsePatchBufferOffsets[n]]);
+          count += NumericTraits<RealType>::OneValue();
+        }
+      }
+      coarseDistances[j] = std::make_pair(count > 0 ? sum / count : NumericTraits<RealType>::max(), j);
+    }
+
+    std::partial_sort(
+      coarseDistances.begin(), coarseDistances.begin() + numberOfCandidates, coarseDistances.end());
+    for (unsigned int k = 0; k < numberOfCandidates; k++)
+    {
+      cellCandidates[cellPosition * this->m_NumberOfCoarseSearchCandidates + k] = coarseDistances[k].second;
+    }
+  }
+
+  return cellRegion;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+SizeValueType
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeRegionPosition(
+  const RegionType & region,
+  const IndexType &  index)
+{
+  SizeValueType position = 0;
+  for (int d = ImageDimension - 1; d >= 0; d--)
+  {
+    position = position * region.GetSize(d) + static_cast<SizeValueType>(index[d] - region.GetIndex(d));
+  }
+  return position;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeRegionIndex(
+  const RegionType &  region,
+  const SizeValueType position) -> IndexType
+{
+  IndexType     index;
+  SizeValueType remainder = position;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    index[d] = region.GetIndex(d) + static_cast<IndexValueType>(remainder % region.GetSize(d));
+    remainder /= region.GetSize(d);
+  }
+  return index;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+uint64_t
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::MixBits(const uint64_t bits)
+{
+  uint64_t z = bits + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputePatchDistance(
+  const IndexType & centerIndex,
+  const IndexType & neighborIndex) const -> RealType
+{
+  const RealType * residualBuffer = this->m_ResidualImage->GetBufferPointer();
+
+  RealType sum = NumericTraits<RealType>::ZeroValue();
+  RealType count = NumericTraits<RealType>::ZeroValue();
+
+  if (this->GetSimilarityMetric() == SimilarityMetricEnum::PEARSON_CORRELATION)
+  {
+    const RealType centerMean = this->m_PatchMeanImage->GetPixel(centerIndex);
+    const RealType neighborMean = this->m_PatchMeanImage->GetPixel(neighborIndex);
+    this->VisitPatchRows(neighborIndex,
+                         centerIndex,
+                         [&](const SizeValueType,
+                             const SizeValueType length,
+                             const IndexType &   neighborRowIndex,
+                             const IndexType &   centerRowIndex) {
+                           sum += SumOfCenteredProducts<0>(
+                             residualBuffer + this->m_ResidualImage->ComputeOffset(neighborRowIndex),
+                             neighborMean,
+                             residualBuffer + this->m_ResidualImage->ComputeOffset(centerRowIndex),
+                             centerMean,
+                             length);
+                           count += static_cast<RealType>(length);
+                         });
+
+    const RealType centerInverseStandardDeviation = this->m_PatchInverseStandardDeviationImage->GetPixel(centerIndex);
+    if (centerInverseStandardDeviation <= NumericTraits<RealType>::ZeroValue())
+    {
+      return NumericTraits<RealType>::ZeroValue();
+    }
+    const RealType correlationDistanceScale =
+      static_cast<RealType>(2.0) / itk::Math::sqr(centerInverseStandardDeviation);
+    return ComputeCorrelationDissimilarity(sum / count,
+                                           centerInverseStandardDeviation,
+                                           this->m_PatchInverseStandardDeviationImage->GetPixel(neighborIndex)) *
+           correlationDistanceScale;
+  }
+
+  this->VisitPatchRows(neighborIndex,
+                       centerIndex,
+                       [&](const SizeValueType,
+                           const SizeValueType length,
+                           const IndexType &   neighborRowIndex,
+                           const IndexType &   centerRowIndex) {
+                         sum += SumOfSquaredDifferences<0>(
+                           residualBuffer + this->m_ResidualImage->ComputeOffset(neighborRowIndex),
+                           residualBuffer + this->m_ResidualImage->ComputeOffset(centerRowIndex),
+                           length);
+                         count += static_cast<RealType>(length);
+                       });
+  return sum / count;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputePatchStatistics()
+{
+  const RegionType & targetImageRegion = this->m_TargetImageRegion;
+  const RegionType   residualRegion = this->m_ResidualImage->GetBufferedRegion();
+  const RealType *   residualBuffer = this->m_ResidualImage->GetBufferPointer();
+
+  this->m_PatchMeanImage = RealImageType::New();
+  this->m_PatchMeanImage->CopyInformation(this->m_ResidualImage);
+  this->m_PatchMeanImage->SetRegions(residualRegion);
+  this->m_PatchMeanImage->Allocate(true);
+
+  this->m_PatchInverseStandardDeviationImage = RealImageType::New();
+  this->m_PatchInverseStandardDeviationImage->CopyInformation(this->m_ResidualImage);
+  this->m_PatchInverseStandardDeviationImage->SetRegions(residualRegion);
+  this->m_PatchInverseStandardDeviationImage->Allocate(true);
+
+  // Only the voxels whose patch, clipped to the target region, lies in the
+  // residual image have statistics.  They include every neighbor searched.
+
+  const NeighborhoodRadiusType neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+
+  RegionType statisticsRegion = residualRegion;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    IndexValueType begin = residualRegion.GetIndex(d);
+    IndexValueType end = begin + static_cast<IndexValueType>(residualRegion.GetSize(d));
+    if (begin > targetImageRegion.GetIndex(d))
+    {
+      begin += static_cast<IndexValueType>(neighborhoodPatchRadius[d]);
+    }
+    if (end < targetImageRegion.GetIndex(d) + static_cast<IndexValueType>(targetImageRegion.GetSize(d)))
+    {
+      end -= static_cast<IndexValueType>(neighborhoodPatchRadius[d]);
+    }
+    statisticsRegion.SetIndex(d, begin);
+    statisticsRegion.SetSize(d, static_cast<SizeValueType>(std::max(end - begin, IndexValueType{ 0 })));
+  }
+  if (statisticsRegion.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  this->GetMultiThreader()->ParallelizeImageRegion(
+    statisticsRegion,
+    [&](const RegionType & subRegion) {
+      ImageRegionIteratorWithIndex<RealImageType> ItP(this->m_PatchMeanImage, subRegion);
+      ImageRegionIterator<RealImageType>          ItS(this->m_PatchInverseStandardDeviationImage, subRegion);
+      for (; !ItP.IsAtEnd(); ++ItP, ++ItS)
+      {
+        const IndexType index = ItP.GetIndex();
+
+        RealType sum = NumericTraits<RealType>::ZeroValue();
+        RealType count = NumericTraits<RealType>::ZeroValue();
+        this->VisitPatchRows(index,
+                             index,
+                             [&](const SizeValueType,
+                                 const SizeValueType length,
+                                 const IndexType &   rowIndex,
+                                 const IndexType &) {
+                               const RealType * row = residualBuffer + this->m_ResidualImage->ComputeOffset(rowIndex);
+                               for (SizeValueType i = 0; i < length; i++)
+                               {
+                                 sum += row[i];
+                               }
+                               count += static_cast<RealType>(length);
+                             });
+        const RealType mean = sum / count;
+
+        RealType sumOfSquares = NumericTraits<RealType>::ZeroValue();
+        this->VisitPatchRows(index,
+                             index,
+                             [&](const SizeValueType,
+                                 const SizeValueType length,
+                                 const IndexType &   rowIndex,
+                                 const IndexType &) {
+                               const RealType * row = residualBuffer + this->m_ResidualImage->ComputeOffset(rowIndex);
+                               sumOfSquares += SumOfCenteredProducts<0>(row, mean, row, mean, length);
+                             });
+        const RealType standardDeviation = std::sqrt(sumOfSquares / count);
+
+        ItP.Set(mean);
+        ItS.Set(standardDeviation < NumericTraits<RealType>::epsilon() ? NumericTraits<RealType>::ZeroValue()
+                                                                      : NumericTraits<RealType>::OneValue() /
+                                                                          standardDeviation);
+      }
+    },
+    nullptr);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeCorrelationDissimilarity(
+  const RealType averageProduct,
+  const RealType inverseStandardDeviation1,
+  const RealType inverseStandardDeviation2) -> RealType
+{
+  // A flat patch correlates with nothing.
+  const RealType dissimilarity =
+    NumericTraits<RealType>::OneValue() - averageProduct * (inverseStandardDeviation1 * inverseStandardDeviation2);
+  return std::min(std::max(dissimilarity, NumericTraits<RealType>::ZeroValue()), static_cast<RealType>(2.0));
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputePatchMatchNeighbors()
+{
+  const InputImageType * inputImage = this->GetInput();
+  const MaskImageType *  maskImage = this->GetMaskImage();
+
+  const RegionType &  targetImageRegion = this->m_TargetImageRegion;
+  const SizeValueType numberOfNeighbors = this->GetNumberOfPatchMatchNeighbors();
+  const unsigned int  numberOfIterations = this->GetNumberOfPatchMatchIterations();
+  const uint64_t      seed = this->GetPatchMatchSeed();
+
+  const SizeValueType emptyNeighbor = NumericTraits<SizeValueType>::max();
+
+  // Every round only reads the neighbors that the previous round found for
+  // the adjacent voxels (Jacobi rather than Gauss-Seidel propagation), and
+  // the random numbers only depend on the seed, the voxel, the round and the
+  // sample.  The neighbors of the centers are thus exact once their region is
+  // padded by the number of rounds, whatever the threads or streamed pieces.
+
+  NeighborhoodRadiusType propagationRadius;
+  propagationRadius.Fill(numberOfIterations);
+
+  RegionType region = this->m_CenterImageRegion;
+  region.PadByRadius(propagationRadius);
+  region.Crop(targetImageRegion);
+
+  const SizeValueType numberOfPixels = region.GetNumberOfPixels();
+
+  // Positions in the target region of the neighbors of every voxel, most
+  // similar first, as found by the previous round and updated by the current
+  // one, and their patch distances.
+  std::vector<SizeValueType> neighbors(numberOfPixels * numberOfNeighbors, emptyNeighbor);
+  std::vector<SizeValueType> nextNeighbors(neighbors);
+  std::vector<RealType>      nextDistances(numberOfPixels * numberOfNeighbors, NumericTraits<RealType>::max());
+
+  SizeValueType searchWidth = 1;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    searchWidth = std::max(searchWidth, static_cast<SizeValueType>(targetImageRegion.GetSize(d)));
+  }
+
+  auto updateNeighbors = [&](const SizeValueType position, const IndexType & index, const IndexType & neighborIndex) {
+    if (neighborIndex == index || !targetImageRegion.IsInside(neighborIndex) ||
+        !this->IsNeighborPreselected(
+          this->m_MeanImage->GetPixel(index), this->m_VarianceImage->GetPixel(index), neighborIndex))
+    {
+      return;
+    }
+    SizeValueType * voxelNeighbors = nextNeighbors.data() + position * numberOfNeighbors;
+    RealType *      voxelDistances = nextDistances.data() + position * numberOfNeighbors;
+
+    const SizeValueType neighborPosition = ComputeRegionPosition(targetImageRegion, neighborIndex);
+    if (std::find(voxelNeighbors, voxelNeighbors + numberOfNeighbors, neighborPosition) !=
+        voxelNeighbors + numberOfNeighbors)
+    {
+      return;
+    }
+    const RealType distance = this->ComputePatchDistance(index, neighborIndex);
+    if (!(distance < voxelDistances[numberOfNeighbors - 1]))
+    {
+      return;
+    }
+    SizeValueType k = numberOfNeighbors - 1;
+    for (; k > 0 && distance < voxelDistances[k - 1]; k--)
+    {
+      voxelNeighbors[k] = voxelNeighbors[k - 1];
+      voxelDistances[k] = voxelDistances[k - 1];
+    }
+    voxelNeighbors[k] = neighborPosition;
+    voxelDistances[k] = distance;
+  };
+
+  // Uniformly drawn voxel of the box of the given radius about the index,
+  // cropped to the target region.
+  auto drawNeighbor = [&](const IndexType &   index,
+                          const IndexType &   boxCenter,
+                          const SizeValueType boxRadius,
+                          const unsigned int  iteration,
+                          const SizeValueType sample) {
+    uint64_t bits = MixBits(seed ^ MixBits(ComputeRegionPosition(targetImageRegion, index)));
+    bits = MixBits(bits ^ MixBits(iteration + (static_cast<uint64_t>(sample) << 32)));
+
+    IndexType neighborIndex;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      const IndexValueType begin = std::max(boxCenter[d] - static_cast<IndexValueType>(boxRadius),
+                                            targetImageRegion.GetIndex(d));
+      const IndexValueType end =
+        std::min(boxCenter[d] + static_cast<IndexValueType>(boxRadius) + 1,
+                 targetImageRegion.GetIndex(d) + static_cast<IndexValueType>(targetImageRegion.GetSize(d)));
+      bits = MixBits(bits);
+      neighborIndex[d] = begin + static_cast<IndexValueType>(bits % static_cast<uint64_t>(end - begin));
+    }
+    return neighborIndex;
+  };
+
+  for (unsigned int iteration = 0; iteration <= numberOfIterations; iteration++)
+  {
+    this->GetMultiThreader()->ParallelizeImageRegion(
+      region,
+      [&](const RegionType & subRegion) {
+        ImageRegionConstIteratorWithIndex<RealImageType> It(this->m_MeanImage, subRegion);
+        for (; !It.IsAtEnd(); ++It)
+        {
+          const IndexType index = It.GetIndex();
+          if (!(inputImage->GetPixel(index) > 0 && It.Get() > this->m_Epsilon &&
+                this->m_VarianceImage->GetPixel(index) > this->m_Epsilon &&
+                (!maskImage || maskImage->GetPixel(index) != NumericTraits<MaskPixelType>::ZeroValue())))
+          {
+            continue;
+          }
+
+          const SizeValueType position = ComputeRegionPosition(region, index);
+
+          if (iteration == 0)
+          {
+            // Random initialization, along with the adjacent voxels.
+            for (unsigned int d = 0; d < ImageDimension; d++)
+            {
+              for (const IndexValueType step : { -1, 1 })
+              {
+                IndexType adjacentIndex = index;
+                adjacentIndex[d] += step;
+                updateNeighbors(position, index, adjacentIndex);
+              }
+            }
+            for (SizeValueType k = 0; k < numberOfNeighbors; k++)
+            {
+              updateNeighbors(position, index, drawNeighbor(index, index, searchWidth, iteration, k));
+            }
+            continue;
+          }
+
+          // Propagation: the neighbors of the adjacent voxels, shifted.
+          for (unsigned int d = 0; d < ImageDimension; d++)
+          {
+            for (const IndexValueType step : { -1, 1 })
+            {
+              IndexType adjacentIndex = index;
+              adjacentIndex[d] += step;
+              if (!region.IsInside(adjacentIndex))
+              {
+                continue;
+              }
+              const SizeValueType * adjacentNeighbors =
+                neighbors.data() + ComputeRegionPosition(region, adjacentIndex) * numberOfNeighbors;
+              for (SizeValueType k = 0; k < numberOfNeighbors && adjacentNeighbors[k] != emptyNeighbor; k++)
+              {
+                IndexType neighborIndex = ComputeRegionIndex(targetImageRegion, adjacentNeighbors[k]);
+                neighborIndex[d] -= step;
+                updateNeighbors(position, index, neighborIndex);
+              }
+            }
+          }
+
+          // Random search about the most similar neighbor, in boxes of
+          // decreasing size.
+          const SizeValueType bestNeighbor = nextNeighbors[position * numberOfNeighbors];
+          if (bestNeighbor == emptyNeighbor)
+          {
+            continue;
+          }
+          const IndexType bestNeighborIndex = ComputeRegionIndex(targetImageRegion, bestNeighbor);
+          SizeValueType   sample = 0;
+          for (SizeValueType boxRadius = searchWidth; boxRadius > 0; boxRadius /= 2)
+          {
+            updateNeighbors(position, index, drawNeighbor(index, bestNeighborIndex, boxRadius, iteration, sample++));
+          }
+        }
+      },
+      nullptr);
+
+    neighbors = nextNeighbors;
+  }
+
+  this->m_PatchMatchRegion = region;
+  this->m_PatchMatchNeighbors = std::move(neighbors);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::GenerateChunkDataWithSummedAreaTables(
+  const RegionType & region,
+  ChunkAccumulator & accumulator)
+{
+  // Rather than comparing the patches of every (center, neighbor) pair voxel
+  // by voxel, the search offsets are visited one at a time.  For a given
+  // offset, the squared residual differences between each voxel and its
+  // shifted counterpart are integrated into a summed-area table, from which
+  // the patch distance of every center is a single box sum.  The patch
+  // estimates are spread the same way: the weights of the offset, normalized
+  // by the sum of weights of their center, are integrated so that every voxel
+  // gathers the contributions of all the patches covering it with one box sum.
+  // The weights are needed twice (once to accumulate the sums of weights and
+  // once to spread the estimates) and are recomputed rather than stored for
+  // every (center, offset) pair.
+
+  struct PatchCenter
+  {
+    IndexType m_Index;
+    RealType  m_Mean;
+    RealType  m_Variance;
+    bool      m_IsSearched;
+    RealType  m_MinimumDistance;
+    RealType  m_MaximumWeight;
+    RealType  m_SumOfWeights;
+  };
+
+  const InputImageType * inputImage = this->GetInput();
+  const MaskImageType *  maskImage = this->GetMaskImage();
+
+  const RegionType targetImageRegion = this->GetTargetImageRegion();
+  const RegionType searchImageRegion = this->m_MeanImage->GetBufferedRegion();
+  const RegionType accumulatorRegion = accumulator.m_Region;
+
+  const NeighborhoodRadiusType     neighborhoodPatchRadius = this->GetNeighborhoodPatchRadius();
+  const NeighborhoodRadiusType     neighborhoodSearchExtent = this->GetNeighborhoodSearchExtent();
+  const NeighborhoodOffsetListType neighborhoodSearchOffsetList = this->GetNeighborhoodSearchOffsetList();
+
+  const unsigned int neighborhoodSearchSize = this->GetNeighborhoodSearchSize();
+  const unsigned int centerSearchOffset = FindCenterSearchOffset(neighborhoodSearchOffsetList);
+
+  TotalProgressReporter progress(this, this->m_CenterImageRegion.GetNumberOfPixels());
+
+  typename RegionType::SizeType unitSize;
+  unitSize.Fill(1);
+
+  auto patchRegionAt = [&unitSize, &neighborhoodPatchRadius](const IndexType & index) {
+    RegionType patchRegion(index, unitSize);
+    patchRegion.PadByRadius(neighborhoodPatchRadius);
+    return patchRegion;
+  };
+
+  // Residuals are needed over the patches of all the neighbors of the slab.
+
+  NeighborhoodRadiusType residualRadius;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    residualRadius[d] = neighborhoodSearchExtent[d] + neighborhoodPatchRadius[d];
+  }
+  RegionType residualRegion = region;
+  residualRegion.PadByRadius(residualRadius);
+  residualRegion.Crop(targetImageRegion);
+
+  // The minimum distances of the other channels are only needed for their
+  // Rician biases.
+
+  const unsigned int numberOfChannels = this->GetNumberOfChannels();
+  const unsigned int numberOfBiasChannels = this->m_UseRicianNoiseModel ? numberOfChannels : 0;
+
+  std::vector<SummedAreaTablePointer> squaredResidualTables;
+  for (unsigned int c = 0; c < std::max(numberOfBiasChannels, 1u); c++)
+  {
+    SummedAreaTablePointer squaredResidualTable = this->AllocateSummedAreaTable(residualRegion);
+
+    ImageRegionConstIterator<RealImageType>  ItR(this->m_ChannelResidualImages[c], residualRegion);
+    ImageRegionIterator<SummedAreaTableType> ItT(squaredResidualTable, residualRegion);
+    for (; !ItR.IsAtEnd(); ++ItR, ++ItT)
+    {
+      ItT.Set(itk::Math::sqr(ItR.Get()));
+    }
+    this->IntegrateSummedAreaTable(squaredResidualTable);
+    squaredResidualTables.push_back(squaredResidualTable);
+  }
+
+  std::vector<RealType> minimumDistances(squaredResidualTables.size());
+
+  // Visit the centers of the slab to compute their minimum distances.  The
+  // Rician bias and the contribution counts only depend on the centers and are
+  // written here, in the same order as the direct engine.
+
+  std::vector<PatchCenter> patchCenters;
+
+  ImageRegionConstIteratorWithIndex<RealImageType> ItM(this->m_MeanImage, region);
+  for (ItM.GoToBegin(); !ItM.IsAtEnd(); ++ItM)
+  {
+    const IndexType centerIndex = ItM.GetIndex();
+    if (!this->IsPatchCenter(centerIndex))
+    {
+      continue;
+    }
+
+    PatchCenter center;
+    center.m_Index = centerIndex;
+    center.m_Mean = ItM.Get();
+    center.m_Variance = this->m_VarianceImage->GetPixel(centerIndex);
+    center.m_IsSearched =
+      inputImage->GetPixel(centerIndex) > 0 && center.m_Mean > this->m_Epsilon && center.m_Variance > this->m_Epsilon &&
+      (!maskImage || maskImage->GetPixel(centerIndex) != NumericTraits<MaskPixelType>::ZeroValue());
+    center.m_MinimumDistance = NumericTraits<RealType>::max();
+    center.m_MaximumWeight = NumericTraits<RealType>::OneValue();
+    center.m_SumOfWeights = NumericTraits<RealType>::ZeroValue();
+
+    RegionType centerPatchRegion = patchRegionAt(centerIndex);
+    centerPatchRegion.Crop(accumulatorRegion);
+
+    if (center.m_IsSearched)
+    {
+      center.m_MaximumWeight = NumericTraits<RealType>::ZeroValue();
+
+      std::fill(minimumDistances.begin(), minimumDistances.end(), NumericTraits<RealType>::max());
+      for (unsigned int m = 0; m < neighborhoodSearchSize; m++)
+      {
+        const IndexType neighborhoodIndex = centerIndex + neighborhoodSearchOffsetList[m];
+        if (m == centerSearchOffset || !searchImageRegion.IsInside(neighborhoodIndex) ||
+            !this->IsNeighborPreselected(center.m_Mean, center.m_Variance, neighborhoodIndex))
+        {
+          continue;
+        }
+
+        RegionType neighborhoodPatchRegion = patchRegionAt(neighborhoodIndex);
+        if (!neighborhoodPatchRegion.Crop(residualRegion))
+        {
+          continue;
+        }
+        for (unsigned int c = 0; c < minimumDistances.size(); c++)
+        {
+          const RealType averageDistance =
+            static_cast<RealType>(this->SumOverRegion(squaredResidualTables[c], neighborhoodPatchRegion) /
+                                  static_cast<double>(neighborhoodPatchRegion.GetNumberOfPixels()));
+          minimumDistances[c] = std::min(averageDistance, minimumDistances[c]);
+        }
+      }
+
+      for (auto & channelMinimumDistance : minimumDistances)
+      {
+        if (itk::Math::AlmostEquals(channelMinimumDistance, NumericTraits<RealType>::ZeroValue()))
+        {
+          channelMinimumDistance = NumericTraits<RealType>::OneValue();
+        }
+      }
+      center.m_MinimumDistance = minimumDistances[0];
+
+      for (unsigned int c = 0; c < numberOfBiasChannels; c++)
+      {
+        RealType bias = minimumDistances[c];
+        if (itk::Math::AlmostEquals(bias, NumericTraits<RealType>::max()))
+        {
+          bias = NumericTraits<RealType>::ZeroValue();
+        }
+        ImageRegionIterator<RealImageType> ItB(accumulator.m_RicianBiasImages[c], centerPatchRegion);
+        for (; !ItB.IsAtEnd(); ++ItB)
+        {
+          ItB.Set(bias);
+        }
+      }
+    }
+
+    patchCenters.push_back(center);
+  }
+
+  // With PEARSON_CORRELATION, the sums of the centered products are expanded
+  // into sums of products and sums of residuals, the latter tabulated once.
+
+  const bool usePearsonCorrelation = this->GetSimilarityMetric() == SimilarityMetricEnum::PEARSON_CORRELATION;
+
+  SummedAreaTablePointer residualTable;
+  if (usePearsonCorrelation)
+  {
+    residualTable = this->AllocateSummedAreaTable(residualRegion);
+
+    ImageRegionConstIterator<RealImageType>  ItR(this->m_ResidualImage, residualRegion);
+    ImageRegionIterator<SummedAreaTableType> ItT(residualTable, residualRegion);
+    for (; !ItR.IsAtEnd(); ++ItR, ++ItT)
+    {
+      ItT.Set(ItR.Get());
+    }
+    this->IntegrateSummedAreaTable(residualTable);
+  }
+
+  // For a given search offset, tabulate the squared residual differences (or
+  // the residual products with PEARSON_CORRELATION) of the voxels whose
+  // shifted counterpart is also in the target region.  The region of these
+  // voxels is returned through the second argument.
+
+  SummedAreaTablePointer distanceTable = this->AllocateSummedAreaTable(accumulatorRegion);
+
+  auto tabulateResidualComparisons = [&](const NeighborhoodOffsetType & offset, RegionType & validRegion) {
+    RegionType shiftedTargetImageRegion = targetImageRegion;
+    shiftedTargetImageRegion.SetIndex(targetImageRegion.GetIndex() - offset);
+
+    validRegion = accumulatorRegion;
+    if (!validRegion.Crop(shiftedTargetImageRegion))
+    {
+      return false;
+    }
+
+    RegionType shiftedValidRegion = validRegion;
+    shiftedValidRegion.SetIndex(validRegion.GetIndex() + offset);
+
+    distanceTable->FillBuffer(0.0);
+
+    ImageRegionConstIterator<RealImageType>  ItR(this->m_ResidualImage, validRegion);
+    ImageRegionConstIterator<RealImageType>  ItS(this->m_ResidualImage, shiftedValidRegion);
+    ImageRegionIterator<SummedAreaTableType> ItT(distanceTable, validRegion);
+    for (; !ItT.IsAtEnd(); ++ItR, ++ItS, ++ItT)
+    {
+      ItT.Set(usePearsonCorrelation ? static_cast<double>(ItS.Get()) * ItR.Get()
+                                    : static_cast<double>(itk::Math::sqr(ItS.Get() - ItR.Get())));
+    }
+    this->IntegrateSummedAreaTable(distanceTable);
+    return true;
+  };
+
+  // Weight of the neighbor at the given offset, or zero if it is not a
+  // candidate.
+
+  auto computeWeight = [&](const PatchCenter &            center,
+                           const NeighborhoodOffsetType & offset,
+                           const RegionType &             validRegion) {
+    const IndexType neighborhoodIndex = center.m_Index + offset;
+    if (!searchImageRegion.IsInside(neighborhoodIndex) ||
+        !this->IsNeighborPreselected(center.m_Mean, center.m_Variance, neighborhoodIndex))
+    {
+      return NumericTraits<RealType>::ZeroValue();
+    }
+
+    RegionType centerPatchRegion = patchRegionAt(center.m_Index);
+    if (!centerPatchRegion.Crop(validRegion))
+    {
+      return NumericTraits<RealType>::ZeroValue();
+    }
+    const double count = static_cast<double>(centerPatchRegion.GetNumberOfPixels());
+
+    RealType averageDistance;
+    if (usePearsonCorrelation)
+    {
+      RegionType neighborhoodPatchRegion = centerPatchRegion;
+      neighborhoodPatchRegion.SetIndex(centerPatchRegion.GetIndex() + offset);
+
+      const double centerMean = this->m_PatchMeanImage->GetPixel(center.m_Index);
+      const double neighborhoodMean = this->m_PatchMeanImage->GetPixel(neighborhoodIndex);
+      const double sumOfCenteredProducts = this->SumOverRegion(distanceTable, centerPatchRegion) -
+                                           neighborhoodMean * this->SumOverRegion(residualTable, centerPatchRegion) -
+                                           centerMean * this->SumOverRegion(residualTable, neighborhoodPatchRegion) +
+                                           count * centerMean * neighborhoodMean;
+
+      const RealType centerInverseStandardDeviation =
+        this->m_PatchInverseStandardDeviationImage->GetPixel(center.m_Index);
+      averageDistance = NumericTraits<RealType>::ZeroValue();
+      if (centerInverseStandardDeviation > 0)
+      {
+        const RealType correlationDistanceScale =
+          static_cast<RealType>(2.0) / itk::Math::sqr(centerInverseStandardDeviation);
+        averageDistance = ComputeCorrelationDissimilarity(
+                            static_cast<RealType>(sumOfCenteredProducts / count),
+                            centerInverseStandardDeviation,
+                            this->m_PatchInverseStandardDeviationImage->GetPixel(neighborhoodIndex)) *
+                          correlationDistanceScale;
+      }
+    }
+    else
+    {
+      averageDistance = static_cast<RealType>(this->SumOverRegion(distanceTable, centerPatchRegion) / count);
+    }
+
+    RealType weight = NumericTraits<RealType>::ZeroValue();
+    if (averageDistance <= static_cast<RealType>(3.0) * center.m_MinimumDistance)
+    {
+      weight = std::exp(-averageDistance / (this->m_SmoothingFactor * center.m_MinimumDistance));
+    }
+    return weight;
+  };
+
+  // First round: the maximum and the sum of the weights of every center.
+
+  for (unsigned int m = 0; m < neighborhoodSearchSize; m++)
+  {
+    if (m == centerSearchOffset)
+    {
+      continue;
+    }
+    RegionType validRegion;
+    if (!tabulateResidualComparisons(neighborhoodSearchOffsetList[m], validRegion))
+    {
+      continue;
+    }
+    for (auto & center : patchCenters)
+    {
+      if (!center.m_IsSearched)
+      {
+        continue;
+      }
+      const RealType weight = computeWeight(center, neighborhoodSearchOffsetList[m], validRegion);
+      if (weight > center.m_MaximumWeight)
+      {
+        center.m_MaximumWeight = weight;
+      }
+      if (weight > NumericTraits<RealType>::ZeroValue())
+      {
+        center.m_SumOfWeights += weight;
+      }
+    }
+  }
+
+  for (auto & center : patchCenters)
+  {
+    if (itk::Math::AlmostEquals(center.m_MaximumWeight, NumericTraits<RealType>::ZeroValue()))
+    {
+      center.m_MaximumWeight = NumericTraits<RealType>::OneValue();
+    }
+    center.m_SumOfWeights += center.m_MaximumWeight;
+  }
 
-  this->m_NeighborhoodRadiusForLocalMeanAndVariance.Fill(1);
-  this->DynamicMultiThreadingOff();
-}
+  // Second round: spread the normalized weighted intensities of every offset,
+  // including the center itself which is weighted by the maximum weight.
 
-template <typename TInputImage, typename TOutputImage, typename TMaskImage>
-void
-AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::BeforeThreadedGenerateData()
-{
-  Superclass::BeforeThreadedGenerateData();
+  SummedAreaTablePointer weightTable = this->AllocateSummedAreaTable(region);
 
-  const InputImageType * inputImage = this->GetInput();
+  const SizeValueType numberOfRegionPixels = region.GetNumberOfPixels();
 
-  typedef MeanImageFilter<InputImageType, RealImageType> MeanImageFilterType;
-  typename MeanImageFilterType::Pointer                  meanImageFilter = MeanImageFilterType::New();
-  meanImageFilter->SetInput(inputImage);
-  meanImageFilter->SetRadius(this->GetNeighborhoodRadiusForLocalMeanAndVariance());
+  for (unsigned int m = 0; m < neighborhoodSearchSize; m++)
+  {
+    const NeighborhoodOffsetType & offset = neighborhoodSearchOffsetList[m];
 
-  this->m_MeanImage = meanImageFilter->GetOutput();
-  this->m_MeanImage->Update();
-  this->m_MeanImage->DisconnectPipeline();
+    weightTable->FillBuffer(0.0);
 
-  typedef VarianceImageFilter<InputImageType, RealImageType> VarianceImageFilterType;
-  typename VarianceImageFilterType::Pointer                  varianceImageFilter = VarianceImageFilterType::New();
-  varianceImageFilter->SetInput(inputImage);
-  varianceImageFilter->SetRadius(this->GetNeighborhoodRadiusForLocalMeanAndVariance());
+    RegionType validRegion = accumulatorRegion;
+    bool       hasValidRegion = true;
+    if (m == centerSearchOffset)
+    {
+      for (const auto & center : patchCenters)
+      {
+        weightTable->SetPixel(center.m_Index, center.m_MaximumWeight / center.m_SumOfWeights);
+      }
+    }
+    else if ((hasValidRegion = tabulateResidualComparisons(offset, validRegion)))
+    {
+      for (const auto & center : patchCenters)
+      {
+        if (!center.m_IsSearched)
+        {
+          continue;
+        }
+        const RealType weight = computeWeight(center, offset, validRegion);
+        if (weight > NumericTraits<RealType>::ZeroValue())
+        {
+          weightTable->SetPixel(center.m_Index, weight / center.m_SumOfWeights);
+        }
+      }
+    }
 
-  this->m_VarianceImage = varianceImageFilter->GetOutput();
-  this->m_VarianceImage->Update();
-  this->m_VarianceImage->DisconnectPipeline();
+    if (hasValidRegion)
+    {
+      this->IntegrateSummedAreaTable(weightTable);
 
-  typedef StatisticsImageFilter<InputImageType> StatsFilterType;
-  typename StatsFilterType::Pointer             statsFilter = StatsFilterType::New();
-  statsFilter->SetInput(inputImage);
-  statsFilter->Update();
+      RegionType shiftedValidRegion = validRegion;
+      shiftedValidRegion.SetIndex(validRegion.GetIndex() + offset);
 
-  this->m_MaximumInputPixelIntensity = static_cast<RealType>(statsFilter->GetMaximum());
-  this->m_MinimumInputPixelIntensity = static_cast<RealType>(statsFilter->GetMinimum());
+      std::vector<ImageRegionConstIterator<InputImageType>> channelIterators;
+      std::vector<ImageRegionIterator<RealImageType>>       estimateIterators;
+      for (unsigned int c = 0; c < numberOfChannels; c++)
+      {
+        channelIterators.emplace_back(this->GetChannel(c), shiftedValidRegion);
+        estimateIterators.emplace_back(accumulator.m_EstimateImages[c], validRegion);
+      }
 
-  this->m_ThreadContributionCountImage = RealImageType::New();
-  this->m_ThreadContributionCountImage->CopyInformation(inputImage);
-  this->m_ThreadContributionCountImage->SetRegions(inputImage->GetRequestedRegion());
-  this->m_ThreadContributionCountImage->Allocate(true);
+      ImageRegionConstIteratorWithIndex<RealImageType> ItE(accumulator.m_EstimateImages[0], validRegion);
+      for (; !ItE.IsAtEnd(); ++ItE)
+      {
+        RegionType patchRegion = patchRegionAt(ItE.GetIndex());
+        patchRegion.Crop(region);
 
-  if (this->m_UseRicianNoiseModel)
+        const RealType normalizedWeight = static_cast<RealType>(this->SumOverRegion(weightTable, patchRegion));
+        for (unsigned int c = 0; c < numberOfChannels; c++)
+        {
+          RealType intensity = static_cast<RealType>(channelIterators[c].Get());
+          if (this->m_UseRicianNoiseModel)
+          {
+            intensity = itk::Math::sqr(intensity);
+          }
+          estimateIterators[c].Set(estimateIterators[c].Get() + intensity * normalizedWeight);
+          ++channelIterators[c];
+          ++estimateIterators[c];
+        }
+      }
+    }
+
+    progress.Completed(numberOfRegionPixels * (m + 1) / neighborhoodSearchSize -
+                       numberOfRegionPixels * m / neighborhoodSearchSize);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::AllocateSummedAreaTable(
+  const RegionType & region) const -> SummedAreaTablePointer
+{
+  RegionType tableRegion = region;
+  for (unsigned int d = 0; d < ImageDimension; d++)
   {
-    this->m_RicianBiasImage = RealImageType::New();
-    this->m_RicianBiasImage->CopyInformation(inputImage);
-    this->m_RicianBiasImage->SetRegions(inputImage->GetRequestedRegion());
-    this->m_RicianBiasImage->Allocate(true);
+    tableRegion.SetIndex(d, region.GetIndex(d) - 1);
+    tableRegion.SetSize(d, region.GetSize(d) + 1);
   }
 
-  this->AllocateOutputs();
-  // Output buffer needs to be zero initialized
-  this->GetOutput()->FillBuffer(0.0);
+  SummedAreaTablePointer table = SummedAreaTableType::New();
+  table->SetRegions(tableRegion);
+  table->Allocate(true);
+  return table;
 }
 
 template <typename TInputImage, typename TOutputImage, typename TMaskImage>
 void
-AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ThreadedGenerateData(
-  const RegionType & region,
-  ThreadIdType       threadId)
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::IntegrateSummedAreaTable(
+  SummedAreaTableType * table) const
 {
-  ProgressReporter progress(this, threadId, region.GetNumberOfPixels(), 100);
-
-  const InputImageType * inputImage = this->GetInput();
-  const MaskImageType *  maskImage = this->GetMaskImage();
+  const OffsetValueType * offsetTable = table->GetOffsetTable();
+  const OffsetValueType   numberOfPixels = offsetTable[ImageDimension];
 
-  OutputImageType * outputImage = this->GetOutput();
-  RegionType        targetImageRegion = this->GetTargetImageRegion();
+  double * buffer = table->GetBufferPointer();
 
-  NeighborhoodOffsetListType neighborhoodPatchOffsetList = this->GetNeighborhoodPatchOffsetList();
+  // Running sums along each axis in turn.  The leading zero row of each line
+  // is skipped so that every line starts from zero.
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    const OffsetValueType stride = offsetTable[d];
+    const OffsetValueType lineLength = offsetTable[d + 1];
+    for (OffsetValueType lineStart = 0; lineStart < numberOfPixels; lineStart += lineLength)
+    {
+      for (OffsetValueType i = lineStart + stride; i < lineStart + lineLength; i++)
+      {
+        buffer[i] += buffer[i - stride];
+      }
+    }
+  }
+}
 
-  NeighborhoodRadiusType neighborhoodSearchRadius = this->GetNeighborhoodSearchRadius();
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+double
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::SumOverRegion(
+  const SummedAreaTableType * table,
+  const RegionType &          region) const
+{
+  const RegionType &      tableRegion = table->GetBufferedRegion();
+  const OffsetValueType * offsetTable = table->GetOffsetTable();
+  const double *          buffer = table->GetBufferPointer();
 
-  ConstNeighborhoodIterator<RealImageType> ItV(neighborhoodSearchRadius, this->m_VarianceImage, region);
-  ConstNeighborhoodIterator<RealImageType> ItM(neighborhoodSearchRadius, this->m_MeanImage, region);
+  // Offsets of the table entries just before the region and at its last voxel
+  // along each axis.
+  OffsetValueType lowerOffsets[ImageDimension];
+  OffsetValueType upperOffsets[ImageDimension];
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    lowerOffsets[d] = (region.GetIndex(d) - 1 - tableRegion.GetIndex(d)) * offsetTable[d];
+    upperOffsets[d] = lowerOffsets[d] + static_cast<OffsetValueType>(region.GetSize(d)) * offsetTable[d];
+  }
 
-  const unsigned int neighborhoodSearchSize = this->GetNeighborhoodSearchSize();
-  const unsigned int neighborhoodPatchSize = this->GetNeighborhoodPatchSize();
+  // Inclusion-exclusion over the 2^N corners of the region.
+  double sum = 0.0;
+  for (unsigned int corner = 0; corner < (1u << ImageDimension); corner++)
+  {
+    OffsetValueType offset = 0;
+    bool            isNegative = false;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      if (corner & (1u << d))
+      {
+        offset += upperOffsets[d];
+      }
+      else
+      {
+        offset += lowerOffsets[d];
+        isNegative = !isNegative;
+      }
+    }
+    sum += isNegative ? -buffer[offset] : buffer[offset];
+  }
+  return sum;
+}
 
-  Array<RealType> weightedAverageIntensities(neighborhoodPatchSize);
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::MergeChunkAccumulator(
+  const ChunkAccumulator & accumulator)
+{
+  // Merged in slab order, the accumulators are added to every voxel in the
+  // order in which a single thread would have visited the centers, and the
+  // bias of the last slab writing to a voxel is kept.
 
-  ItM.GoToBegin();
-  ItV.GoToBegin();
+  const unsigned int numberOfOutputs = this->GetNumberOfParameterSets() * this->GetNumberOfChannels();
 
-  while (!ItM.IsAtEnd())
+  for (unsigned int channel = 0; channel < numberOfOutputs; channel++)
   {
-    typename InputImageType::IndexType centerIndex = ItM.GetIndex();
-
-    InputPixelType inputCenterPixel = inputImage->GetPixel(centerIndex);
-    RealType       meanCenterPixel = this->m_MeanImage->GetPixel(centerIndex);
-    RealType       varianceCenterPixel = this->m_VarianceImage->GetPixel(centerIndex);
+    OutputImageType * outputImage = this->GetOutput(channel);
 
-    RealType maxWeight = NumericTraits<RealType>::ZeroValue();
-    RealType sumOfWeights = NumericTraits<RealType>::ZeroValue();
+    RegionType outputOverlapRegion = accumulator.m_Region;
+    if (outputOverlapRegion.Crop(outputImage->GetBufferedRegion()))
+    {
+      ImageRegionIterator<OutputImageType>    ItO(outputImage, outputOverlapRegion);
+      ImageRegionConstIterator<RealImageType> ItE(accumulator.m_EstimateImages[channel], outputOverlapRegion);
+      for (; !ItO.IsAtEnd(); ++ItO, ++ItE)
+      {
+        ItO.Set(ItO.Get() + ItE.Get());
+      }
+    }
 
-    weightedAverageIntensities.Fill(NumericTraits<RealType>::ZeroValue());
+    if (!this->m_UseRicianNoiseModel)
+    {
+      continue;
+    }
 
-    RealType meanNeighborhoodPixel = NumericTraits<RealType>::ZeroValue();
-    RealType varianceNeighborhoodPixel = NumericTraits<RealType>::ZeroValue();
+    RealImageType * ricianBiasImage = this->m_RicianBiasImages[channel];
 
-    if (inputCenterPixel > 0 && meanCenterPixel > this->m_Epsilon && varianceCenterPixel > this->m_Epsilon &&
-        (!maskImage || maskImage->GetPixel(centerIndex) != NumericTraits<MaskPixelType>::ZeroValue()))
+    RegionType ricianBiasOverlapRegion = accumulator.m_Region;
+    if (ricianBiasOverlapRegion.Crop(ricianBiasImage->GetBufferedRegion()))
     {
-      // Calculate the minimum distance
-
-      RealType minimumDistance = NumericTraits<RealType>::max();
-      for (unsigned int m = 0; m < neighborhoodSearchSize; m++)
+      ImageRegionIterator<RealImageType>      ItB(ricianBiasImage, ricianBiasOverlapRegion);
+      ImageRegionConstIterator<RealImageType> ItA(accumulator.m_RicianBiasImages[channel], ricianBiasOverlapRegion);
+      for (; !ItB.IsAtEnd(); ++ItB, ++ItA)
       {
-        if (!ItM.IndexInBounds(m) || m == static_cast<unsigned int>(0.5 * neighborhoodSearchSize))
+        if (ItA.Get() >= NumericTraits<RealType>::ZeroValue())
         {
-          continue;
+          ItB.Set(ItA.Get());
         }
+      }
+    }
+  }
+}
 
-        IndexType neighborhoodIndex = ItM.GetIndex(m);
+template <typename TInputImage, typename TOutputImage, typename TMaskImage>
+void
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::AfterThreadedGenerateData()
+{
+  const MaskImageType * maskImage = this->GetMaskImage();
+  const bool            isMaskedExecution = this->IsMaskedExecution();
 
-        if (inputImage->GetPixel(neighborhoodIndex) <= 0)
-        {
-          continue;
-        }
+  this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
 
-        meanNeighborhoodPixel = this->m_MeanImage->GetPixel(neighborhoodIndex);
-        varianceNeighborhoodPixel = this->m_VarianceImage->GetPixel(neighborhoodIndex);
+  const unsigned int            numberOfChannels = this->GetNumberOfChannels();
+  const unsigned int            numberOfOutputs = this->GetNumberOfParameterSets() * numberOfChannels;
+  const SweepParametersListType parameterSets = this->GetParameterSets();
 
-        if (meanNeighborhoodPixel <= this->m_Epsilon || varianceNeighborhoodPixel <= this->m_Epsilon)
-        {
-          continue;
-        }
+  // With half precision, the local mean of the input image is expanded back
+  // for the Rician correction and the intermediate outputs, and so is its
+  // variance for the latter.  The half precision images are then released.
+  if (this->m_AuxiliaryImagePrecision == AuxiliaryImagePrecisionEnum::HALF)
+  {
+    if (this->m_UseRicianNoiseModel || this->m_ComputeIntermediateOutputs)
+    {
+      this->m_MeanImage = this->ConvertToRealImage(this->m_HalfMeanImage, this->m_HalfMeanScale);
+      this->m_ChannelMeanImages[0] = this->m_MeanImage;
+    }
+    if (this->m_ComputeIntermediateOutputs)
+    {
+      this->m_VarianceImage = this->ConvertToRealImage(this->m_HalfVarianceImage, this->m_HalfVarianceScale);
+    }
+    this->m_HalfMeanImage = nullptr;
+    this->m_HalfVarianceImage = nullptr;
+    this->m_HalfResidualImages.clear();
+  }
+
+  // Every channel has its own bias map, corrected with its own local mean,
+  // and every parameter set smooths it with its own variance.  The noise
+  // level of the input image is kept on the way for the intermediate outputs.
+  RealImagePointer noiseSigmaImage;
+  for (unsigned int c = 0; c < numberOfOutputs && this->m_UseRicianNoiseModel; c++)
+  {
+    RealImagePointer &    ricianBiasImage = this->m_RicianBiasImages[c];
+    const RealImageType * meanImage = this->m_ChannelMeanImages[c % numberOfChannels];
+    const RealType        smoothingVariance = parameterSets[c / numberOfChannels].m_SmoothingVariance;
+
+    // Masked voxels keep the raw bias, so the bias map is only smoothed in
+    // place when there is no mask.
+
+    RealImagePointer smoothedImage;
+    if (this->m_RicianBiasSmoother == RicianBiasSmootherEnum::RECURSIVE_GAUSSIAN)
+    {
+      typedef SmoothingRecursiveGaussianImageFilter<RealImageType, RealImageType> SmootherType;
+      typename SmootherType::Pointer smoother = SmootherType::New();
+      smoother->SetInput(ricianBiasImage);
+      smoother->SetSigma(std::sqrt(smoothingVariance));
+      smoother->SetInPlace(maskImage == nullptr);
+      smoother->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+      smoother->Update();
+
+      smoothedImage = smoother->GetOutput();
+      smoothedImage->DisconnectPipeline();
+      if (maskImage == nullptr)
+      {
+        ricianBiasImage = smoothedImage;
+      }
+    }
+    else
+    {
+      typedef DiscreteGaussianImageFilter<RealImageType, RealImageType> SmootherType;
+      typename SmootherType::Pointer                                    smoother = SmootherType::New();
+      smoother->SetInput(ricianBiasImage);
+      smoother->SetVariance(smoothingVariance);
+      smoother->SetUseImageSpacing(true);
+      smoother->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+      smoother->Update();
+
+      smoothedImage = smoother->GetOutput();
+    }
 
-        const RealType meanRatio = meanCenterPixel / meanNeighborhoodPixel;
-        const RealType meanRatioInverse = (this->m_MaximumInputPixelIntensity - meanCenterPixel) /
-                                          (this->m_MaximumInputPixelIntensity - meanNeighborhoodPixel);
+    // With the masked execution, the voxels outside the bounding box of the
+    // mask are all left out, and so is the local mean.
+    RegionType correctionRegion = ricianBiasImage->GetBufferedRegion();
+    if (isMaskedExecution && !correctionRegion.Crop(this->m_MaskBoundingBox))
+    {
+      continue;
+    }
 
-        const RealType varianceRatio = varianceCenterPixel / varianceNeighborhoodPixel;
+    RealImageType * channelNoiseSigmaImage = nullptr;
+    if (this->m_ComputeIntermediateOutputs && c == 0)
+    {
+      noiseSigmaImage = RealImageType::New();
+      noiseSigmaImage->CopyInformation(ricianBiasImage);
+      noiseSigmaImage->SetRegions(correctionRegion);
+      noiseSigmaImage->Allocate(true);
+      channelNoiseSigmaImage = noiseSigmaImage;
+    }
 
-        if (((meanRatio > this->m_MeanThreshold &&
-              meanRatio < itk::NumericTraits<RealType>::OneValue() / this->m_MeanThreshold) ||
-             (meanRatioInverse > this->m_MeanThreshold &&
-              meanRatioInverse < itk::NumericTraits<RealType>::OneValue() / this->m_MeanThreshold)) &&
-            varianceRatio > this->m_VarianceThreshold &&
-            varianceRatio < itk::NumericTraits<RealType>::OneValue() / this->m_VarianceThreshold)
+    this->GetMultiThreader()->ParallelizeImageRegion(
+      correctionRegion,
+      [this, maskImage, meanImage, channelNoiseSigmaImage, &smoothedImage, &ricianBiasImage](
+        const RegionType & region) {
+        ImageRegionConstIterator<RealImageType> ItS(smoothedImage, region);
+        ImageRegionConstIterator<RealImageType> ItM(meanImage, region);
+        ImageRegionIterator<RealImageType>      ItB(ricianBiasImage, region);
+        ImageRegionConstIterator<MaskImageType> ItK;
+        ImageRegionIterator<RealImageType>      ItN;
+        if (maskImage)
+        {
+          ItK = ImageRegionConstIterator<MaskImageType>(maskImage, region);
+        }
+        if (channelNoiseSigmaImage)
         {
+          ItN = ImageRegionIterator<RealImageType>(channelNoiseSigmaImage, region);
+        }
 
-          RealType averageDistance = itk::NumericTraits<RealType>::ZeroValue();
-          RealType count = itk::NumericTraits<RealType>::ZeroValue();
+        for (; !ItS.IsAtEnd(); ++ItS, ++ItM, ++ItB)
+        {
+          const bool isMasked = maskImage && ItK.Get() == NumericTraits<MaskPixelType>::ZeroValue();
+          if (maskImage)
+          {
+            ++ItK;
+          }
 
-          for (unsigned int n = 0; n < neighborhoodPatchSize; n++)
+          if (ItS.Get() > itk::NumericTraits<RealType>::ZeroValue() && !isMasked)
           {
-            IndexType neighborhoodPatchIndex = neighborhoodIndex + neighborhoodPatchOffsetList[n];
+            const RealType noiseSigma = std::sqrt(ItS.Get());
+            if (channelNoiseSigmaImage)
+            {
+              ItN.Set(noiseSigma);
+            }
+
+            const RealType snr = ItM.Get() / noiseSigma;
 
-            if (!targetImageRegion.IsInside(neighborhoodPatchIndex))
+            RealType bias = static_cast<RealType>(2.0) * ItS.Get() / this->CalculateCorrectionFactor(snr);
+
+            if (std::isnan(bias) || std::isinf(bias))
             {
-              continue;
+              bias = itk::NumericTraits<RealType>::ZeroValue();
             }
-            RealType neighborhoodInputImagePixel = static_cast<RealType>(inputImage->GetPixel(neighborhoodPatchIndex));
-            RealType neighborhoodMeanImagePixel = this->m_MeanImage->GetPixel(neighborhoodPatchIndex);
-            averageDistance += itk::Math::sqr(neighborhoodInputImagePixel - neighborhoodMeanImagePixel);
+            ItB.Set(bias);
+          }
+          else if (!isMasked && ItB.Get() < NumericTraits<RealType>::ZeroValue())
+          {
+            // The recursive filter may undershoot slightly around steep edges.
+            ItB.Set(NumericTraits<RealType>::ZeroValue());
+          }
 
-            count += itk::NumericTraits<RealType>::OneValue();
+          if (channelNoiseSigmaImage)
+          {
+            ++ItN;
           }
-          averageDistance /= count;
-          minimumDistance = std::min(averageDistance, minimumDistance);
         }
-      }
+      },
+      nullptr);
+  }
 
-      if (itk::Math::AlmostEquals(minimumDistance, NumericTraits<RealType>::ZeroValue()))
-      {
-        minimumDistance = NumericTraits<RealType>::OneValue();
-      }
+  // Every visited center contributes to each voxel of its patch, so the
+  // number of contributions only depends on the geometry and is the product
+  // of the counts along each axis.
 
-      // Rician correction
+  const RegionType outputRegion = this->GetOutput()->GetRequestedRegion();
 
-      if (this->m_UseRicianNoiseModel)
-      {
-        for (unsigned int n = 0; n < neighborhoodPatchSize; n++)
+  std::vector<RealType> contributionCounts[ImageDimension];
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    contributionCounts[d] = this->ComputeContributionCounts(d);
+  }
+
+  for (unsigned int c = 0; c < numberOfOutputs; c++)
+  {
+    OutputImageType *      outputImage = this->GetOutput(c);
+    const InputImageType * channelImage = this->GetChannel(c % numberOfChannels);
+    RealImageType *        ricianBiasImage = nullptr;
+    if (this->m_UseRicianNoiseModel)
+    {
+      ricianBiasImage = this->m_RicianBiasImages[c];
+    }
+
+    // With the masked execution, the voxels outside the mask keep their input
+    // intensity.  Those outside the bounding box of the mask are copied in
+    // slabs on either side of the box along each axis in turn, and the
+    // estimates, as well as the Rician bias map, only cover the box.
+    this->GetMultiThreader()->ParallelizeImageRegion(
+      outputRegion,
+      [this,
+       &outputRegion,
+       &contributionCounts,
+       outputImage,
+       channelImage,
+       ricianBiasImage,
+       maskImage,
+       isMaskedExecution](const RegionType & region) {
+        RegionType estimateRegion = region;
+        if (isMaskedExecution)
         {
-          IndexType neighborhoodPatchIndex = centerIndex + neighborhoodPatchOffsetList[n];
-          if (!targetImageRegion.IsInside(neighborhoodPatchIndex))
-          {
-            continue;
-          }
+          const auto copyInputRegion = [outputImage, channelImage](const RegionType & copyRegion) {
+            ImageRegionIterator<OutputImageType>     ItO(outputImage, copyRegion);
+            ImageRegionConstIterator<InputImageType> ItI(channelImage, copyRegion);
+            for (; !ItO.IsAtEnd(); ++ItO, ++ItI)
+            {
+              ItO.Set(static_cast<OutputPixelType>(ItI.Get()));
+            }
+          };
 
-          if (itk::Math::AlmostEquals(minimumDistance, NumericTraits<RealType>::max()))
-          {
-            this->m_RicianBiasImage->SetPixel(neighborhoodPatchIndex, 0.0);
-          }
-          else
+          if (!estimateRegion.Crop(this->m_MaskBoundingBox))
           {
-            this->m_RicianBiasImage->SetPixel(neighborhoodPatchIndex, minimumDistance);
+            copyInputRegion(region);
+            return;
           }
-        }
-      }
 
-      // Patch filtering
+          RegionType remainingRegion = region;
+          for (unsigned int d = 0; d < ImageDimension; d++)
+          {
+            const IndexValueType lower = remainingRegion.GetIndex(d);
+            const IndexValueType upper = lower + static_cast<IndexValueType>(remainingRegion.GetSize(d));
+            const IndexValueType boxLower = estimateRegion.GetIndex(d);
+            const IndexValueType boxUpper = boxLower + static_cast<IndexValueType>(estimateRegion.GetSize(d));
 
-      for (unsigned int m = 0; m < neighborhoodSearchSize; m++)
-      {
-        if (!ItM.IndexInBounds(m) || m == static_cast<unsigned int>(0.5 * neighborhoodSearchSize))
-        {
-          continue;
+            RegionType slabRegion = remainingRegion;
+            if (boxLower > lower)
+            {
+              slabRegion.SetIndex(d, lower);
+              slabRegion.SetSize(d, static_cast<SizeValueType>(boxLower - lower));
+              copyInputRegion(slabRegion);
+            }
+            if (boxUpper < upper)
+            {
+              slabRegion.SetIndex(d, boxUpper);
+              slabRegion.SetSize(d, static_cast<SizeValueType>(upper - boxUpper));
+              copyInputRegion(slabRegion);
+            }
+            remainingRegion.SetIndex(d, boxLower);
+            remainingRegion.SetSize(d, estimateRegion.GetSize(d));
+          }
         }
 
-        IndexType neighborhoodIndex = ItM.GetIndex(m);
-
-        if (inputImage->GetPixel(neighborhoodIndex) <= 0)
+        ImageRegionIteratorWithIndex<OutputImageType> ItO(outputImage, estimateRegion);
+        ImageRegionConstIterator<RealImageType>       ItB;
+        ImageRegionConstIterator<InputImageType>      ItI;
+        ImageRegionConstIterator<MaskImageType>       ItK;
+        if (isMaskedExecution)
         {
-          continue;
+          ItI = ImageRegionConstIterator<InputImageType>(channelImage, estimateRegion);
+          ItK = ImageRegionConstIterator<MaskImageType>(maskImage, estimateRegion);
         }
-
-        meanNeighborhoodPixel = this->m_MeanImage->GetPixel(neighborhoodIndex);
-        varianceNeighborhoodPixel = this->m_VarianceImage->GetPixel(neighborhoodIndex);
-
-        if (meanNeighborhoodPixel <= this->m_Epsilon || varianceNeighborhoodPixel <= this->m_Epsilon)
+        if (this->m_UseRicianNoiseModel)
         {
-          continue;
+          ItB = ImageRegionConstIterator<RealImageType>(ricianBiasImage, estimateRegion);
         }
 
-        const RealType meanRatio = meanCenterPixel / meanNeighborhoodPixel;
-        const RealType meanRatioInverse = (this->m_MaximumInputPixelIntensity - meanCenterPixel) /
-                                          (this->m_MaximumInputPixelIntensity - meanNeighborhoodPixel);
-
-        const RealType varianceRatio = varianceCenterPixel / varianceNeighborhoodPixel;
-
-        if (((meanRatio > this->m_MeanThreshold &&
-              meanRatio < itk::NumericTraits<RealType>::OneValue() / this->m_MeanThreshold) ||
-             (meanRatioInverse > this->m_MeanThreshold &&
-              meanRatioInverse < itk::NumericTraits<RealType>::OneValue() / this->m_MeanThreshold)) &&
-            varianceRatio > this->m_VarianceThreshold &&
-            varianceRatio < itk::NumericTraits<RealType>::OneValue() / this->m_VarianceThreshold)
+        for (; !ItO.IsAtEnd(); ++ItO)
         {
+          const IndexType index = ItO.GetIndex();
 
-          RealType averageDistance = 0.0;
-          RealType count = 0.0;
-          for (unsigned int n = 0; n < neighborhoodPatchSize; n++)
+          RealType bias = NumericTraits<RealType>::ZeroValue();
+          if (this->m_UseRicianNoiseModel)
+          {
+            bias = ItB.Get();
+            ++ItB;
+          }
+          if (isMaskedExecution)
           {
-            IndexType searchNeighborhoodPatchIndex = neighborhoodIndex + neighborhoodPatchOffsetList[n];
-            IndexType centerNeighborhoodPatchIndex = centerIndex + neighborhoodPatchOffsetList[n];
-            if (!targetImageRegion.IsInside(searchNeighborhoodPatchIndex) ||
-                !targetImageRegion.IsInside(centerNeighborhoodPatchIndex))
+            const bool           isMasked = ItK.Get() == NumericTraits<MaskPixelType>::ZeroValue();
+            const InputPixelType inputPixel = ItI.Get();
+            ++ItK;
+            ++ItI;
+            if (isMasked)
             {
+              ItO.Set(static_cast<OutputPixelType>(inputPixel));
               continue;
             }
-            RealType distance1 = inputImage->GetPixel(searchNeighborhoodPatchIndex) -
-                                 this->m_MeanImage->GetPixel(searchNeighborhoodPatchIndex);
-            RealType distance2 = inputImage->GetPixel(centerNeighborhoodPatchIndex) -
-                                 this->m_MeanImage->GetPixel(centerNeighborhoodPatchIndex);
-            averageDistance += itk::Math::sqr(distance1 - distance2);
-            count += itk::NumericTraits<RealType>::OneValue();
           }
-          averageDistance /= count;
 
-          RealType weight = itk::NumericTraits<RealType>::ZeroValue();
-          if (averageDistance <= static_cast<RealType>(3.0) * minimumDistance)
+          RealType contributionCount = NumericTraits<RealType>::OneValue();
+          for (unsigned int d = 0; d < ImageDimension; d++)
           {
-            weight = std::exp(-averageDistance / minimumDistance);
+            contributionCount *= contributionCounts[d][index[d] - outputRegion.GetIndex(d)];
           }
-          if (weight > maxWeight)
+
+          if (itk::Math::FloatAlmostEqual(contributionCount, itk::NumericTraits<RealType>::ZeroValue()))
           {
-            maxWeight = weight;
+            continue;
           }
 
-          if (weight > itk::NumericTraits<RealType>::ZeroValue())
+          RealType estimate = ItO.Get() / contributionCount;
+
+          if (this->m_UseRicianNoiseModel)
           {
-            for (unsigned int n = 0; n < neighborhoodPatchSize; n++)
+            estimate -= bias;
+            if (estimate < itk::NumericTraits<RealType>::ZeroValue())
             {
-              IndexType neighborhoodPatchIndex = neighborhoodIndex + neighborhoodPatchOffsetList[n];
-              if (!targetImageRegion.IsInside(neighborhoodPatchIndex))
-              {
-                continue;
-              }
-              if (this->m_UseRicianNoiseModel)
-              {
-                weightedAverageIntensities[n] += weight * itk::Math::sqr(inputImage->GetPixel(neighborhoodPatchIndex));
-              }
-              else
-              {
-                weightedAverageIntensities[n] += weight * inputImage->GetPixel(neighborhoodPatchIndex);
-              }
+              estimate = itk::NumericTraits<RealType>::ZeroValue();
             }
-            sumOfWeights += weight;
+            estimate = std::sqrt(estimate);
           }
-        }
-      }
-
-      if (itk::Math::AlmostEquals(maxWeight, NumericTraits<RealType>::ZeroValue()))
-      {
-        maxWeight = NumericTraits<RealType>::OneValue();
-      }
-    }
-    else
-    {
-      maxWeight = NumericTraits<RealType>::OneValue();
-    }
-
-    for (unsigned int n = 0; n < neighborhoodPatchSize; n++)
-    {
-      IndexType neighborhoodPatchIndex = centerIndex + neighborhoodPatchOffsetList[n];
-      if (!targetImageRegion.IsInside(neighborhoodPatchIndex))
-      {
-        continue;
-      }
-      if (this->m_UseRicianNoiseModel)
-      {
-        weightedAverageIntensities[n] += maxWeight * itk::Math::sqr(inputImage->GetPixel(neighborhoodPatchIndex));
-      }
-      else
-      {
-        weightedAverageIntensities[n] += maxWeight * inputImage->GetPixel(neighborhoodPatchIndex);
-      }
-    }
-    sumOfWeights += maxWeight;
 
-    if (sumOfWeights > itk::NumericTraits<RealType>::ZeroValue())
-    {
-      for (unsigned int n = 0; n < neighborhoodPatchSize; n++)
-      {
-        IndexType neighborhoodPatchIndex = centerIndex + neighborhoodPatchOffsetList[n];
-        if (!targetImageRegion.IsInside(neighborhoodPatchIndex))
-        {
-          continue;
+          ItO.Set(estimate);
         }
-        typename OutputImageType::PixelType estimate = outputImage->GetPixel(neighborhoodPatchIndex);
-        estimate += (weightedAverageIntensities[n] / sumOfWeights);
-
-        outputImage->SetPixel(neighborhoodPatchIndex, estimate);
-        this->m_ThreadContributionCountImage->SetPixel(
-          neighborhoodPatchIndex, this->m_ThreadContributionCountImage->GetPixel(neighborhoodPatchIndex) + 1);
-      }
-    }
-
-    ++ItM;
-    ++ItV;
+      },
+      nullptr);
+  }
 
-    progress.CompletedPixel();
+  if (this->m_ComputeIntermediateOutputs)
+  {
+    this->CopyToIntermediateOutput(this->m_MeanImage, this->GetLocalMeanOutput());
+    this->CopyToIntermediateOutput(this->m_VarianceImage, this->GetLocalVarianceOutput());
+    this->CopyToIntermediateOutput(noiseSigmaImage, this->GetNoiseSigmaOutput());
+    this->CopyToIntermediateOutput(this->m_UseRicianNoiseModel ? this->m_RicianBiasImages[0].GetPointer() : nullptr,
+                                   this->GetRicianBiasOutput());
   }
 }
 
 template <typename TInputImage, typename TOutputImage, typename TMaskImage>
-void
-AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::AfterThreadedGenerateData()
+auto
+AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::ComputeContributionCounts(
+  const unsigned int axis) const -> std::vector<RealType>
 {
-  const MaskImageType * maskImage = this->GetMaskImage();
-
-  if (this->m_UseRicianNoiseModel)
-  {
-    typedef DiscreteGaussianImageFilter<RealImageType, RealImageType> SmootherType;
-    typename SmootherType::Pointer                                    smoother = SmootherType::New();
-    smoother->SetInput(this->m_RicianBiasImage);
-    smoother->SetVariance(this->m_SmoothingVariance);
-    smoother->SetUseImageSpacing(true);
-    smoother->Update();
-
-    ImageRegionConstIterator<RealImageType> ItS(smoother->GetOutput(), smoother->GetOutput()->GetRequestedRegion());
-    ImageRegionConstIteratorWithIndex<RealImageType> ItM(this->m_MeanImage, this->m_MeanImage->GetRequestedRegion());
-    ImageRegionIterator<RealImageType> ItB(this->m_RicianBiasImage, this->m_RicianBiasImage->GetRequestedRegion());
-    ItS.GoToBegin();
-    ItM.GoToBegin();
-    ItB.GoToBegin();
-
-    while (!ItS.IsAtEnd())
-    {
-      if (ItS.Get() > itk::NumericTraits<RealType>::ZeroValue() &&
-          (!maskImage || maskImage->GetPixel(ItM.GetIndex()) != NumericTraits<MaskPixelType>::ZeroValue()))
-      {
-        const RealType snr = ItM.Get() / std::sqrt(ItS.Get());
-
-        RealType bias = static_cast<RealType>(2.0) * ItS.Get() / this->CalculateCorrectionFactor(snr);
-
-        if (std::isnan(bias) || std::isinf(bias))
-        {
-          bias = itk::NumericTraits<RealType>::ZeroValue();
-        }
-        ItB.Set(bias);
-      }
+  // The centers are the grid positions of the target region, and a voxel is
+  // covered by the centers within the patch radius of it.
 
-      ++ItS;
-      ++ItM;
-      ++ItB;
-    }
-  }
+  const RegionType &   outputRegion = this->GetOutput()->GetRequestedRegion();
+  const IndexValueType begin = this->m_TargetImageRegion.GetIndex(axis);
+  const IndexValueType end = begin + static_cast<IndexValueType>(this->m_TargetImageRegion.GetSize(axis));
+  const IndexValueType radius = static_cast<IndexValueType>(this->GetNeighborhoodPatchRadius()[axis]);
 
-  ImageRegionIteratorWithIndex<OutputImageType> ItO(this->GetOutput(), this->GetOutput()->GetRequestedRegion());
-  ImageRegionConstIterator<RealImageType>       ItL(this->m_ThreadContributionCountImage,
-                                              this->m_ThreadContributionCountImage->GetRequestedRegion());
+  const IndexValueType outputBegin = outputRegion.GetIndex(axis);
+  const IndexValueType outputEnd = outputBegin + static_cast<IndexValueType>(outputRegion.GetSize(axis));
 
-  for (ItO.GoToBegin(), ItL.GoToBegin(); !ItO.IsAtEnd(); ++ItO, ++ItL)
+  std::vector<RealType> contributionCounts(outputRegion.GetSize(axis), NumericTraits<RealType>::ZeroValue());
+  for (IndexValueType position = outputBegin; position < outputEnd; position++)
   {
-    RealType estimate = ItO.Get();
-
-    if (itk::Math::FloatAlmostEqual(ItL.Get(), itk::NumericTraits<RealType>::ZeroValue()))
-    {
-      continue;
-    }
-
-    estimate /= ItL.Get();
-
-    if (this->m_UseRicianNoiseModel)
+    for (IndexValueType center = std::max(begin, position - radius); center < std::min(end, position + radius + 1);
+         center++)
     {
-      RealType bias = this->m_RicianBiasImage->GetPixel(ItO.GetIndex());
-
-      estimate -= bias;
-      if (estimate < itk::NumericTraits<RealType>::ZeroValue())
+      if (this->IsPatchCenterAlongAxis(center, axis))
       {
-        estimate = itk::NumericTraits<RealType>::ZeroValue();
+        contributionCounts[position - outputBegin] += NumericTraits<RealType>::OneValue();
       }
-      estimate = std::sqrt(estimate);
     }
-
-    ItO.Set(estimate);
   }
+  return contributionCounts;
 }
 
 template <typename TInputImage, typename TOutputImage, typename TMaskImage>
 typename AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::RealType
 AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>::CalculateCorrectionFactor(
-  RealType snr)
+  RealType snr) const
 {
-  const RealType snrSquared = itk::Math::sqr(snr);
-
-  RealType value =
-    static_cast<RealType>(2.0) + snrSquared -
-    static_cast<RealType>(0.125) * static_cast<RealType>(Math::pi) *
-      static_cast<RealType>(std::exp(static_cast<RealType>(-0.5) * snrSquared)) *
-      itk::Math::sqr((static_cast<RealType>(2.0) + snrSquared) *
-                       static_cast<RealType>(
-                         this->m_ModifiedBesselCalculator.ModifiedBesselI0(static_cast<RealType>(0.25) * snrSquared)) +
-                     snrSquared * static_cast<RealType>(this->m_ModifiedBesselCalculator.ModifiedBesselI1(
-                                    static_cast<RealType>(0.25) * snrSquared)));
-
-  if (value < static_cast<RealType>(0.001) || value > static_cast<RealType>(10.0))
-  {
-    value = itk::NumericTraits<RealType>::OneValue();
-  }
-  return value;
+  return static_cast<RealType>(RicianNoiseCorrectionFactor::Evaluate(static_cast<double>(snr)));
 }
 
 template <typename TInputImage, typename TOutputImage, typename TMaskImage>
@@ -513,10 +4104,36 @@ AdaptiveNonLocalMeansDenoisingImageFilter<TInputImage, TOutputImage, TMaskImage>
   os << indent << "Mean threshold = " << this->m_MeanThreshold << std::endl;
   os << indent << "Variance threshold = " << this->m_VarianceThreshold << std::endl;
   os << indent << "Smoothing variance = " << this->m_SmoothingVariance << std::endl;
+  os << indent << "Rician bias smoother = " << this->m_RicianBiasSmoother << std::endl;
 
   os << indent
      << "Neighborhood radius for local mean and variance = " << this->m_NeighborhoodRadiusForLocalMeanAndVariance
      << std::endl;
+  os << indent << "Center stride = " << this->m_CenterStride << std::endl;
+  os << indent << "Patch distance engine = " << this->m_PatchDistanceEngine << std::endl;
+  os << indent << "Use patch distance early termination = "
+     << (this->m_UsePatchDistanceEarlyTermination ? "On" : "Off") << std::endl;
+  os << indent << "Use symmetric patch distances = " << (this->m_UseSymmetricPatchDistances ? "On" : "Off")
+     << std::endl;
+  os << indent << "Use coarse-to-fine search = " << (this->m_UseCoarseToFineSearch ? "On" : "Off") << std::endl;
+  os << indent << "Number of coarse search candidates = " << this->m_NumberOfCoarseSearchCandidates << std::endl;
+  os << indent << "Coarse search refinement radius = " << this->m_CoarseSearchRefinementRadius << std::endl;
+  os << indent << "Number of channels = " << this->GetNumberOfChannels() << std::endl;
+  os << indent << "Number of parameter sets = " << this->GetNumberOfParameterSets() << std::endl;
+  os << indent << "Use masked execution = " << (this->m_UseMaskedExecution ? "On" : "Off") << std::endl;
+  os << indent << "Use tiled traversal = " << (this->m_UseTiledTraversal ? "On" : "Off") << std::endl;
+  os << indent << "Tile cache size = " << this->m_TileCacheSize << std::endl;
+  os << indent << "Auxiliary image precision = " << this->m_AuxiliaryImagePrecision << std::endl;
+  os << indent << "Compute intermediate outputs = " << (this->m_ComputeIntermediateOutputs ? "On" : "Off")
+     << std::endl;
+  if (this->m_ComputeMaximumInputPixelIntensity)
+  {
+    os << indent << "Computing the maximum input pixel intensity." << std::endl;
+  }
+  else
+  {
+    os << indent << "Maximum input pixel intensity = " << this->m_MaximumInputPixelIntensity << std::endl;
+  }
 }
 
 } // end namespace itk
@@ -0,0 +1,174 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkLocalMeanAndVarianceImageFilter_h
+#define itkLocalMeanAndVarianceImageFilter_h
+
+#include "itkBoxImageFilter.h"
+#include "itkImage.h"
+#include "itkNumericTraits.h"
+
+#include <mutex>
+
+namespace itk
+{
+/** \class LocalMeanAndVarianceImageFilter
+ * \brief Computes the local mean and variance of an image in a single pass
+ *
+ * Computes the mean (first output) and the variance (second output) of the
+ * pixels in a box neighborhood about every input pixel.  The results are
+ * those of MeanImageFilter and VarianceImageFilter, with the same zero-flux
+ * Neumann boundary condition, up to floating point round-off.  The same
+ * sweep optionally produces the residual, i.e. the input minus the local
+ * mean (third output), and always records the minimum and the maximum of the
+ * input over the output requested region.
+ *
+ * The box sums are computed separably with running sums along each axis so
+ * that the cost per pixel does not depend on the radius.  The running sums
+ * use compensated summation in double precision, and they are restarted at
+ * fixed positions of the image grid so that the result does not depend on
+ * how the image is split between threads or streamed pieces.
+ *
+ * \sa MeanImageFilter
+ * \sa VarianceImageFilter
+ *
+ * \ingroup AdaptiveDenoising
+ */
+template <typename TInputImage, typename TOutputImage>
+class ITK_TEMPLATE_EXPORT LocalMeanAndVarianceImageFilter final : public BoxImageFilter<TInputImage, TOutputImage>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(LocalMeanAndVarianceImageFilter);
+
+  /** Extract dimension from input and output image. */
+  static constexpr unsigned int InputImageDimension = TInputImage::ImageDimension;
+  static constexpr unsigned int OutputImageDimension = TOutputImage::ImageDimension;
+
+  /** Convenient typedefs for simplifying declarations. */
+  typedef TInputImage  InputImageType;
+  typedef TOutputImage OutputImageType;
+
+  /** Standard class typedefs. */
+  typedef LocalMeanAndVarianceImageFilter                 Self;
+  typedef BoxImageFilter<InputImageType, OutputImageType> Superclass;
+  typedef SmartPointer<Self>                              Pointer;
+  typedef SmartPointer<const Self>                        ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkOverrideGetNameOfClassMacro(LocalMeanAndVarianceImageFilter);
+
+  /** Image typedef support. */
+  typedef typename InputImageType::PixelType  InputPixelType;
+  typedef typename OutputImageType::PixelType OutputPixelType;
+
+  typedef typename InputImageType::RegionType  InputImageRegionType;
+  typedef typename OutputImageType::RegionType OutputImageRegionType;
+
+  typedef typename InputImageType::SizeType InputSizeType;
+
+  /** Local mean image. */
+  OutputImageType *
+  GetMeanOutput()
+  {
+    return this->GetOutput(0);
+  }
+
+  /** Local variance image. */
+  OutputImageType *
+  GetVarianceOutput()
+  {
+    return this->GetOutput(1);
+  }
+
+  /** Input minus the local mean.  Only generated if ComputeResidual is on. */
+  OutputImageType *
+  GetResidualOutput()
+  {
+    return this->GetOutput(2);
+  }
+
+  /** Generate the residual output.  Default = false. */
+  itkSetMacro(ComputeResidual, bool);
+  itkGetConstMacro(ComputeResidual, bool);
+  itkBooleanMacro(ComputeResidual);
+
+  /** Minimum and maximum input intensities over the output requested region. */
+  itkGetConstMacro(Minimum, InputPixelType);
+  itkGetConstMacro(Maximum, InputPixelType);
+
+  /**
+   * Input region needed to compute the given output region, for an input
+   * image with the given largest possible region.  It is the output region
+   * padded by the radius, and extended back to the previous restart of the
+   * running sums.
+   */
+  InputImageRegionType
+  ComputeInputRequestedRegion(const OutputImageRegionType &, const InputImageRegionType &) const;
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+  // Begin concept checking
+  itkConceptMacro(InputHasNumericTraitsCheck, (Concept::HasNumericTraits<InputPixelType>));
+  // End concept checking
+#endif
+
+protected:
+  LocalMeanAndVarianceImageFilter();
+  ~LocalMeanAndVarianceImageFilter() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  void
+  GenerateInputRequestedRegion() override;
+
+  /** Only allocate the residual output when it is requested. */
+  void
+  AllocateOutputs() override;
+
+  void
+  BeforeThreadedGenerateData() override;
+
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+private:
+  typedef Image<double, InputImageDimension> SumImageType;
+
+  /** Distance between two restarts of the running sums along the given axis. */
+  IndexValueType
+  GetRestartInterval(const unsigned int) const;
+
+  /** First restart of the running sums at or before the index along the given axis. */
+  IndexValueType
+  GetPreviousRestart(const IndexValueType, const unsigned int, const InputImageRegionType &) const;
+
+  bool m_ComputeResidual;
+
+  InputPixelType m_Minimum;
+  InputPixelType m_Maximum;
+  std::mutex     m_Mutex;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkLocalMeanAndVarianceImageFilter.hxx"
+#endif
+
+#endif
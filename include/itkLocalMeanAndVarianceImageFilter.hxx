@@ -0,0 +1,335 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkLocalMeanAndVarianceImageFilter_hxx
+#define itkLocalMeanAndVarianceImageFilter_hxx
+
+#include "itkCompensatedSummation.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+#include "itkMath.h"
+#include "itkTotalProgressReporter.h"
+
+namespace itk
+{
+template <typename TInputImage, typename TOutputImage>
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::LocalMeanAndVarianceImageFilter()
+  : m_ComputeResidual(false)
+  , m_Minimum(NumericTraits<InputPixelType>::max())
+  , m_Maximum(NumericTraits<InputPixelType>::NonpositiveMin())
+{
+  this->SetNumberOfRequiredOutputs(2);
+  this->SetNthOutput(1, this->MakeOutput(1));
+  this->SetNthOutput(2, this->MakeOutput(2));
+}
+
+template <typename TInputImage, typename TOutputImage>
+IndexValueType
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::GetRestartInterval(const unsigned int axis) const
+{
+  // Restarting costs a full window sum, so this bounds the overhead to a
+  // quarter of an update per pixel.
+  return 4 * (2 * static_cast<IndexValueType>(this->GetRadius()[axis]) + 1);
+}
+
+template <typename TInputImage, typename TOutputImage>
+IndexValueType
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::GetPreviousRestart(
+  const IndexValueType         index,
+  const unsigned int           axis,
+  const InputImageRegionType & largestPossibleRegion) const
+{
+  const IndexValueType interval = this->GetRestartInterval(axis);
+  const IndexValueType origin = largestPossibleRegion.GetIndex(axis);
+
+  IndexValueType quotient = (index - origin) / interval;
+  if (quotient * interval > index - origin)
+  {
+    quotient--;
+  }
+  return origin + quotient * interval;
+}
+
+template <typename TInputImage, typename TOutputImage>
+auto
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::ComputeInputRequestedRegion(
+  const OutputImageRegionType & outputRegion,
+  const InputImageRegionType &  largestPossibleRegion) const -> InputImageRegionType
+{
+  const InputSizeType radius = this->GetRadius();
+
+  InputImageRegionType inputRegion = outputRegion;
+  for (unsigned int d = 0; d < InputImageDimension; d++)
+  {
+    const IndexValueType radiusAlongAxis = static_cast<IndexValueType>(radius[d]);
+    const IndexValueType begin =
+      this->GetPreviousRestart(outputRegion.GetIndex(d), d, largestPossibleRegion) - radiusAlongAxis;
+    const IndexValueType end =
+      outputRegion.GetIndex(d) + static_cast<IndexValueType>(outputRegion.GetSize(d)) + radiusAlongAxis;
+    inputRegion.SetIndex(d, begin);
+    inputRegion.SetSize(d, static_cast<SizeValueType>(end - begin));
+  }
+  inputRegion.Crop(largestPossibleRegion);
+  return inputRegion;
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * inputImage = const_cast<InputImageType *>(this->GetInput());
+  if (!inputImage)
+  {
+    return;
+  }
+  inputImage->SetRequestedRegion(
+    this->ComputeInputRequestedRegion(this->GetOutput()->GetRequestedRegion(), inputImage->GetLargestPossibleRegion()));
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::AllocateOutputs()
+{
+  const unsigned int numberOfOutputs = this->m_ComputeResidual ? 3 : 2;
+  for (unsigned int i = 0; i < numberOfOutputs; i++)
+  {
+    OutputImageType * output = this->GetOutput(i);
+    output->SetBufferedRegion(output->GetRequestedRegion());
+    output->Allocate();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::BeforeThreadedGenerateData()
+{
+  this->m_Minimum = NumericTraits<InputPixelType>::max();
+  this->m_Maximum = NumericTraits<InputPixelType>::NonpositiveMin();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
+{
+  const InputImageType * input = this->GetInput();
+  OutputImageType *      meanOutput = this->GetMeanOutput();
+  OutputImageType *      varianceOutput = this->GetVarianceOutput();
+
+  const InputImageRegionType & bufferedRegion = input->GetBufferedRegion();
+  const InputImageRegionType & largestPossibleRegion = input->GetLargestPossibleRegion();
+  const InputSizeType          radius = this->GetRadius();
+
+  TotalProgressReporter progress(this, this->GetOutput()->GetRequestedRegion().GetNumberOfPixels());
+
+  // The sums over the first d axes are needed over the output region,
+  // extended along the remaining axes by the reach of the running sums, and
+  // clamped to the buffered region (zero-flux Neumann boundary condition).
+
+  std::vector<InputImageRegionType> sumRegions(InputImageDimension + 1);
+  sumRegions[InputImageDimension] = outputRegionForThread;
+  for (int d = InputImageDimension - 1; d >= 0; d--)
+  {
+    InputImageRegionType sumRegion = sumRegions[d + 1];
+    const IndexValueType radiusAlongAxis = static_cast<IndexValueType>(radius[d]);
+    const IndexValueType begin =
+      this->GetPreviousRestart(sumRegion.GetIndex(d), d, largestPossibleRegion) - radiusAlongAxis;
+    const IndexValueType end =
+      sumRegion.GetIndex(d) + static_cast<IndexValueType>(sumRegion.GetSize(d)) + radiusAlongAxis;
+    sumRegion.SetIndex(d, begin);
+    sumRegion.SetSize(d, static_cast<SizeValueType>(end - begin));
+    sumRegion.Crop(bufferedRegion);
+    sumRegions[d] = sumRegion;
+  }
+
+  auto allocateSumImage = [](const InputImageRegionType & region) {
+    typename SumImageType::Pointer image = SumImageType::New();
+    image->SetRegions(region);
+    image->Allocate();
+    return image;
+  };
+
+  typename SumImageType::Pointer sumImage = allocateSumImage(sumRegions[0]);
+  typename SumImageType::Pointer sumOfSquaresImage = allocateSumImage(sumRegions[0]);
+  {
+    ImageRegionConstIterator<InputImageType> ItI(input, sumRegions[0]);
+    ImageRegionIterator<SumImageType>        ItS(sumImage, sumRegions[0]);
+    ImageRegionIterator<SumImageType>        ItQ(sumOfSquaresImage, sumRegions[0]);
+    for (; !ItI.IsAtEnd(); ++ItI, ++ItS, ++ItQ)
+    {
+      const double value = static_cast<double>(ItI.Get());
+      ItS.Set(value);
+      ItQ.Set(value * value);
+    }
+  }
+
+  for (unsigned int d = 0; d < InputImageDimension; d++)
+  {
+    const InputImageRegionType & sourceRegion = sumRegions[d];
+    const InputImageRegionType & targetRegion = sumRegions[d + 1];
+
+    typename SumImageType::Pointer targetSumImage = allocateSumImage(targetRegion);
+    typename SumImageType::Pointer targetSumOfSquaresImage = allocateSumImage(targetRegion);
+
+    const double * sourceSums = sumImage->GetBufferPointer();
+    const double * sourceSumsOfSquares = sumOfSquaresImage->GetBufferPointer();
+    double *       targetSums = targetSumImage->GetBufferPointer();
+    double *       targetSumsOfSquares = targetSumOfSquaresImage->GetBufferPointer();
+
+    const OffsetValueType sourceStride = sumImage->GetOffsetTable()[d];
+    const OffsetValueType targetStride = targetSumImage->GetOffsetTable()[d];
+
+    const IndexValueType radiusAlongAxis = static_cast<IndexValueType>(radius[d]);
+    const IndexValueType restartInterval = this->GetRestartInterval(d);
+    const IndexValueType bufferBegin = bufferedRegion.GetIndex(d);
+    const IndexValueType bufferLast = bufferBegin + static_cast<IndexValueType>(bufferedRegion.GetSize(d)) - 1;
+    const IndexValueType targetBegin = targetRegion.GetIndex(d);
+    const IndexValueType targetEnd = targetBegin + static_cast<IndexValueType>(targetRegion.GetSize(d));
+    const IndexValueType firstRestart = this->GetPreviousRestart(targetBegin, d, largestPossibleRegion);
+
+    // Position along the axis, clamped to the buffered region, relative to
+    // the start of the source region.
+    auto sourcePosition = [&](const IndexValueType index) {
+      return std::min(std::max(index, bufferBegin), bufferLast) - sourceRegion.GetIndex(d);
+    };
+
+    InputImageRegionType lineRegion = targetRegion;
+    lineRegion.SetSize(d, 1);
+
+    ImageRegionConstIteratorWithIndex<SumImageType> ItL(targetSumImage, lineRegion);
+    for (ItL.GoToBegin(); !ItL.IsAtEnd(); ++ItL)
+    {
+      typename InputImageType::IndexType lineIndex = ItL.GetIndex();
+      const OffsetValueType              targetLineOffset = targetSumImage->ComputeOffset(lineIndex);
+      lineIndex[d] = sourceRegion.GetIndex(d);
+      const OffsetValueType sourceLineOffset = sumImage->ComputeOffset(lineIndex);
+
+      auto sourceOffset = [&](const IndexValueType index) {
+        return sourceLineOffset + sourcePosition(index) * sourceStride;
+      };
+
+      CompensatedSummation<double> sum;
+      CompensatedSummation<double> sumOfSquares;
+      for (IndexValueType index = firstRestart; index < targetEnd; index++)
+      {
+        if ((index - firstRestart) % restartInterval == 0)
+        {
+          sum.ResetToZero();
+          sumOfSquares.ResetToZero();
+          for (IndexValueType neighbor = index - radiusAlongAxis; neighbor <= index + radiusAlongAxis; neighbor++)
+          {
+            sum += sourceSums[sourceOffset(neighbor)];
+            sumOfSquares += sourceSumsOfSquares[sourceOffset(neighbor)];
+          }
+        }
+        else
+        {
+          const OffsetValueType entering = sourceOffset(index + radiusAlongAxis);
+          const OffsetValueType leaving = sourceOffset(index - radiusAlongAxis - 1);
+          sum += sourceSums[entering];
+          sum -= sourceSums[leaving];
+          sumOfSquares += sourceSumsOfSquares[entering];
+          sumOfSquares -= sourceSumsOfSquares[leaving];
+        }
+
+        if (index >= targetBegin)
+        {
+          const OffsetValueType targetOffset = targetLineOffset + (index - targetBegin) * targetStride;
+          targetSums[targetOffset] = sum.GetSum();
+          targetSumsOfSquares[targetOffset] = sumOfSquares.GetSum();
+        }
+      }
+    }
+
+    sumImage = targetSumImage;
+    sumOfSquaresImage = targetSumOfSquaresImage;
+  }
+
+  double numberOfNeighbors = 1.0;
+  for (unsigned int d = 0; d < InputImageDimension; d++)
+  {
+    numberOfNeighbors *= static_cast<double>(2 * radius[d] + 1);
+  }
+
+  // The residual is formed from the mean rounded to the output pixel type so
+  // that it matches subtracting the mean output from the input.
+
+  InputPixelType minimum = NumericTraits<InputPixelType>::max();
+  InputPixelType maximum = NumericTraits<InputPixelType>::NonpositiveMin();
+
+  OutputImageType * residualOutput = this->m_ComputeResidual ? this->GetResidualOutput() : nullptr;
+
+  ImageRegionConstIterator<InputImageType> ItI(input, outputRegionForThread);
+  ImageRegionConstIterator<SumImageType>   ItS(sumImage, outputRegionForThread);
+  ImageRegionConstIterator<SumImageType>   ItQ(sumOfSquaresImage, outputRegionForThread);
+  ImageRegionIterator<OutputImageType>     ItM(meanOutput, outputRegionForThread);
+  ImageRegionIterator<OutputImageType>     ItV(varianceOutput, outputRegionForThread);
+  ImageRegionIterator<OutputImageType>     ItR;
+  if (residualOutput)
+  {
+    ItR = ImageRegionIterator<OutputImageType>(residualOutput, outputRegionForThread);
+  }
+  for (; !ItM.IsAtEnd(); ++ItI, ++ItS, ++ItQ, ++ItM, ++ItV)
+  {
+    const InputPixelType value = ItI.Get();
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+
+    const double sum = ItS.Get();
+    const double variance = (ItQ.Get() - itk::Math::sqr(sum) / numberOfNeighbors) / (numberOfNeighbors - 1.0);
+
+    const OutputPixelType mean = static_cast<OutputPixelType>(sum / numberOfNeighbors);
+    ItM.Set(mean);
+    ItV.Set(static_cast<OutputPixelType>(std::max(variance, 0.0)));
+
+    if (residualOutput)
+    {
+      ItR.Set(static_cast<OutputPixelType>(value) - mean);
+      ++ItR;
+    }
+  }
+
+  {
+    const std::lock_guard<std::mutex> lock(this->m_Mutex);
+    this->m_Minimum = std::min(this->m_Minimum, minimum);
+    this->m_Maximum = std::max(this->m_Maximum, maximum);
+  }
+
+  progress.Completed(outputRegionForThread.GetNumberOfPixels());
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+LocalMeanAndVarianceImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  if (this->m_ComputeResidual)
+  {
+    os << indent << "Computing the residual." << std::endl;
+  }
+  os << indent << "Minimum = " << static_cast<typename NumericTraits<InputPixelType>::PrintType>(this->m_Minimum)
+     << std::endl;
+  os << indent << "Maximum = " << static_cast<typename NumericTraits<InputPixelType>::PrintType>(this->m_Maximum)
+     << std::endl;
+}
+} // end namespace itk
+
+#endif
@@ -45,10 +45,51 @@ public:
     PEARSON_CORRELATION = 0,
     MEAN_SQUARES = 1
   };
+
+  /**\class SearchPattern
+   * \brief Subset of the search neighborhood which is visited.
+   *
+   * DENSE visits every offset of the search box.  STRIDED only keeps the
+   * offsets whose components are all multiples of the stride.  AXIAL only
+   * keeps the offsets along the image axes.  RINGS keeps every offset within
+   * the stride of the center and decimates the farther rings (the offsets at
+   * the same Chebyshev distance k) with a spacing of ceil(k / stride) voxels,
+   * so that every ring has about the same number of offsets.  The center is
+   * always part of the search.
+   * \ingroup AdaptiveDenoising
+   */
+  enum class SearchPattern : uint8_t
+  {
+    DENSE = 0,
+    STRIDED = 1,
+    AXIAL = 2,
+    RINGS = 3
+  };
+
+  /**\class SearchStrategy
+   * \brief How the neighbors of every voxel are found.
+   *
+   * SEARCH_NEIGHBORHOOD visits the search offsets (see SearchPattern).
+   * PATCH_MATCH keeps the most similar neighbors of every voxel, anywhere in
+   * the image, found by a randomized PatchMatch search (Barnes et al.,
+   * "PatchMatch: a randomized correspondence algorithm for structural image
+   * editing", SIGGRAPH 2009) whose cost does not depend on the distance of
+   * the matches.
+   * \ingroup AdaptiveDenoising
+   */
+  enum class SearchStrategy : uint8_t
+  {
+    SEARCH_NEIGHBORHOOD = 0,
+    PATCH_MATCH = 1
+  };
 };
 
 extern AdaptiveDenoising_EXPORT std::ostream &
 operator<<(std::ostream & out, const NonLocalPatchBasedImageFilterEnums::SimilarityMetric value);
+extern AdaptiveDenoising_EXPORT std::ostream &
+operator<<(std::ostream & out, const NonLocalPatchBasedImageFilterEnums::SearchPattern value);
+extern AdaptiveDenoising_EXPORT std::ostream &
+operator<<(std::ostream & out, const NonLocalPatchBasedImageFilterEnums::SearchStrategy value);
 
 
 /**
@@ -113,6 +154,9 @@ public:
   static constexpr SimilarityMetricType MEAN_SQUARES = SimilarityMetricEnum::MEAN_SQUARES;
 #endif
 
+  using SearchPatternEnum = NonLocalPatchBasedImageFilterEnums::SearchPattern;
+  using SearchStrategyEnum = NonLocalPatchBasedImageFilterEnums::SearchStrategy;
+
   /**
    * Get/set neighborhood search radius.
    * Default = 3x3x...
@@ -127,16 +171,58 @@ public:
   itkGetConstMacro(NeighborhoodSearchSize, NeighborhoodSizeType);
 
   /**
-   * Get/set neighborhood search offset list.
+   * Get/set neighborhood search offset list.  A non-empty list replaces the
+   * search pattern and may reach beyond the search radius; the zero offset is
+   * added to it if it is missing.  An empty list restores the search pattern.
+   * After an update, the list holds the offsets which were searched.
    */
   virtual void
   SetNeighborhoodSearchOffsetList(const NeighborhoodOffsetListType list)
   {
+    this->m_CustomNeighborhoodSearchOffsetList = list;
     this->m_NeighborhoodSearchOffsetList = list;
     this->Modified();
   }
   itkGetConstMacro(NeighborhoodSearchOffsetList, NeighborhoodOffsetListType);
 
+  /**
+   * Get/set the offsets of the search neighborhood which are visited.  The
+   * sparse patterns search a large radius for a fraction of the cost of the
+   * whole box.  Default = DENSE
+   */
+  itkSetMacro(SearchPattern, SearchPatternEnum);
+  itkGetConstMacro(SearchPattern, SearchPatternEnum);
+
+  /**
+   * Get/set the stride of the STRIDED search pattern, which is also the radius
+   * of the densely searched core of the RINGS search pattern.  Default = 2
+   */
+  itkSetMacro(SearchPatternStride, unsigned int);
+  itkGetConstMacro(SearchPatternStride, unsigned int);
+
+  /**
+   * Get/set how the neighbors of every voxel are found.  Subclasses which do
+   * not support PATCH_MATCH throw an exception.  Default = SEARCH_NEIGHBORHOOD
+   */
+  itkSetMacro(SearchStrategy, SearchStrategyEnum);
+  itkGetConstMacro(SearchStrategy, SearchStrategyEnum);
+
+  /** Get/set the number of neighbors kept for every voxel by PATCH_MATCH.  Default = 8 */
+  itkSetMacro(NumberOfPatchMatchNeighbors, unsigned int);
+  itkGetConstMacro(NumberOfPatchMatchNeighbors, unsigned int);
+
+  /** Get/set the number of propagation and random search rounds of PATCH_MATCH.  Default = 4 */
+  itkSetMacro(NumberOfPatchMatchIterations, unsigned int);
+  itkGetConstMacro(NumberOfPatchMatchIterations, unsigned int);
+
+  /**
+   * Get/set the seed of the random numbers of PATCH_MATCH.  The random numbers
+   * only depend on the seed and on the voxel, so the result does not depend
+   * on the number of threads or on streaming.  Default = 0
+   */
+  itkSetMacro(PatchMatchSeed, unsigned int);
+  itkGetConstMacro(PatchMatchSeed, unsigned int);
+
   /**
    * Get/set neighborhood patch radius.
    * Default = 1x1x...
@@ -183,6 +269,17 @@ protected:
                                      const InputImagePixelVectorType &,
                                      const bool);
 
+  /**
+   * Radius of the smallest box which holds the search offsets.  It is known
+   * before the update, so that the input requested region can depend on it.
+   */
+  NeighborhoodRadiusType
+  GetNeighborhoodSearchExtent() const;
+
+  /** Whether the whole patch centered at the index lies inside the target region. */
+  bool
+  IsPatchInsideTargetImageRegion(const IndexType) const;
+
   InputImagePixelVectorType
   VectorizeImageListPatch(const InputImageList &, const IndexType, const bool);
 
@@ -197,15 +294,29 @@ protected:
 
   SimilarityMetricEnum m_SimilarityMetric;
 
+  SearchPatternEnum m_SearchPattern;
+  unsigned int      m_SearchPatternStride;
+
+  SearchStrategyEnum m_SearchStrategy;
+  unsigned int       m_NumberOfPatchMatchNeighbors;
+  unsigned int       m_NumberOfPatchMatchIterations;
+  unsigned int       m_PatchMatchSeed;
+
   SizeValueType              m_NeighborhoodSearchSize;
   NeighborhoodRadiusType     m_NeighborhoodSearchRadius;
   NeighborhoodOffsetListType m_NeighborhoodSearchOffsetList;
+  NeighborhoodOffsetListType m_CustomNeighborhoodSearchOffsetList;
 
   SizeValueType              m_NeighborhoodPatchSize;
   NeighborhoodRadiusType     m_NeighborhoodPatchRadius;
   NeighborhoodOffsetListType m_NeighborhoodPatchOffsetList;
 
   RegionType m_TargetImageRegion;
+
+private:
+  /** Whether the search pattern visits the given offset of the search box. */
+  bool
+  IsInSearchPattern(const NeighborhoodOffsetType &) const;
 };
 
 } // end namespace itk
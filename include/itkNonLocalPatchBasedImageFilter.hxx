@@ -21,6 +21,8 @@
 
 #include "itkNeighborhood.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -34,6 +36,15 @@ NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::NonLocalPatchBasedImag
 
   this->m_NeighborhoodSearchRadius.Fill(3);
   this->m_NeighborhoodSearchOffsetList.clear();
+  this->m_CustomNeighborhoodSearchOffsetList.clear();
+
+  this->m_SearchPattern = SearchPatternEnum::DENSE;
+  this->m_SearchPatternStride = 2;
+
+  this->m_SearchStrategy = SearchStrategyEnum::SEARCH_NEIGHBORHOOD;
+  this->m_NumberOfPatchMatchNeighbors = 8;
+  this->m_NumberOfPatchMatchIterations = 4;
+  this->m_PatchMatchSeed = 0;
 }
 
 template <typename TInputImage, typename TOutputImage>
@@ -42,16 +53,39 @@ NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::BeforeThreadedGenerate
 {
   // Set up the search neighborhood parameters
 
+  if (this->m_SearchPatternStride < 1)
+  {
+    itkExceptionMacro("The search pattern stride must be at least 1.");
+  }
+
   this->m_NeighborhoodSearchOffsetList.clear();
 
-  NeighborhoodType searchNeighborhood;
-  searchNeighborhood.SetRadius(this->m_NeighborhoodSearchRadius);
+  if (!this->m_CustomNeighborhoodSearchOffsetList.empty())
+  {
+    this->m_NeighborhoodSearchOffsetList = this->m_CustomNeighborhoodSearchOffsetList;
 
-  this->m_NeighborhoodSearchSize = searchNeighborhood.Size();
-  for (unsigned int n = 0; n < this->m_NeighborhoodSearchSize; n++)
+    const NeighborhoodOffsetType zeroOffset{};
+    if (std::find(this->m_NeighborhoodSearchOffsetList.begin(),
+                  this->m_NeighborhoodSearchOffsetList.end(),
+                  zeroOffset) == this->m_NeighborhoodSearchOffsetList.end())
+    {
+      this->m_NeighborhoodSearchOffsetList.push_back(zeroOffset);
+    }
+  }
+  else
   {
-    this->m_NeighborhoodSearchOffsetList.push_back(searchNeighborhood.GetOffset(n));
+    NeighborhoodType searchNeighborhood;
+    searchNeighborhood.SetRadius(this->m_NeighborhoodSearchRadius);
+
+    for (unsigned int n = 0; n < searchNeighborhood.Size(); n++)
+    {
+      if (this->IsInSearchPattern(searchNeighborhood.GetOffset(n)))
+      {
+        this->m_NeighborhoodSearchOffsetList.push_back(searchNeighborhood.GetOffset(n));
+      }
+    }
   }
+  this->m_NeighborhoodSearchSize = this->m_NeighborhoodSearchOffsetList.size();
 
   // Set up the patch neighborhood parameters
 
@@ -69,6 +103,90 @@ NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::BeforeThreadedGenerate
   this->m_TargetImageRegion = this->GetInput()->GetRequestedRegion();
 }
 
+template <typename TInputImage, typename TOutputImage>
+bool
+NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::IsInSearchPattern(const NeighborhoodOffsetType & offset) const
+{
+  const OffsetValueType stride = static_cast<OffsetValueType>(this->m_SearchPatternStride);
+
+  OffsetValueType distance = 0;
+  unsigned int    numberOfNonZeroComponents = 0;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    distance = std::max(distance, std::abs(offset[d]));
+    numberOfNonZeroComponents += (offset[d] != 0);
+  }
+
+  switch (this->m_SearchPattern)
+  {
+    case SearchPatternEnum::STRIDED:
+      for (unsigned int d = 0; d < ImageDimension; d++)
+      {
+        if (offset[d] % stride != 0)
+        {
+          return false;
+        }
+      }
+      return true;
+    case SearchPatternEnum::AXIAL:
+      return numberOfNonZeroComponents <= 1;
+    case SearchPatternEnum::RINGS:
+    {
+      // The components which do not lie on the ring itself are decimated.
+      const OffsetValueType spacing = std::max(OffsetValueType{ 1 }, (distance + stride - 1) / stride);
+      for (unsigned int d = 0; d < ImageDimension; d++)
+      {
+        if (std::abs(offset[d]) != distance && offset[d] % spacing != 0)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+    case SearchPatternEnum::DENSE:
+    default:
+      return true;
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+auto
+NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::GetNeighborhoodSearchExtent() const -> NeighborhoodRadiusType
+{
+  if (this->m_CustomNeighborhoodSearchOffsetList.empty())
+  {
+    return this->m_NeighborhoodSearchRadius;
+  }
+
+  NeighborhoodRadiusType extent;
+  extent.Fill(0);
+  for (const auto & offset : this->m_CustomNeighborhoodSearchOffsetList)
+  {
+    for (unsigned int d = 0; d < ImageDimension; d++)
+    {
+      extent[d] = std::max(extent[d], static_cast<SizeValueType>(std::abs(offset[d])));
+    }
+  }
+  return extent;
+}
+
+template <typename TInputImage, typename TOutputImage>
+bool
+NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::IsPatchInsideTargetImageRegion(const IndexType index) const
+{
+  for (unsigned int d = 0; d < ImageDimension; d++)
+  {
+    const IndexValueType radius = static_cast<IndexValueType>(this->m_NeighborhoodPatchRadius[d]);
+    const IndexValueType begin = this->m_TargetImageRegion.GetIndex(d);
+    const IndexValueType end = begin + static_cast<IndexValueType>(this->m_TargetImageRegion.GetSize(d));
+    if (index[d] - radius < begin || index[d] + radius >= end)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
 template <typename TInputImage, typename TOutputImage>
 typename NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::InputImagePixelVectorType
 NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::VectorizeImageListPatch(const InputImageList & imageList,
@@ -93,12 +211,16 @@ NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::VectorizeImagePatch(co
                                                                               const IndexType         index,
                                                                               const bool              normalize)
 {
+  // Patches away from the boundary of the target region need no per-voxel
+  // bounds checking.
+  const bool isInteriorPatch = this->IsPatchInsideTargetImageRegion(index);
+
   InputImagePixelVectorType patchVector(this->m_NeighborhoodPatchSize);
   for (SizeValueType i = 0; i < this->m_NeighborhoodPatchSize; i++)
   {
     IndexType neighborhoodIndex = index + this->m_NeighborhoodPatchOffsetList[i];
 
-    bool isInBounds = this->m_TargetImageRegion.IsInside(neighborhoodIndex);
+    bool isInBounds = isInteriorPatch || this->m_TargetImageRegion.IsInside(neighborhoodIndex);
     if (isInBounds)
     {
       InputPixelType pixel = image->GetPixel(neighborhoodIndex);
@@ -178,6 +300,8 @@ NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::ComputeNeighborhoodPat
   RealType sumXY = 0.0;
   RealType N = 0.0;
 
+  const bool isInteriorPatch = this->IsPatchInsideTargetImageRegion(index);
+
   SizeValueType count = 0;
   for (SizeValueType i = 0; i < numberOfImagesToUse; i++)
   {
@@ -185,7 +309,7 @@ NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::ComputeNeighborhoodPat
     {
       IndexType neighborhoodIndex = index + this->m_NeighborhoodPatchOffsetList[j];
 
-      bool isInBounds = this->m_TargetImageRegion.IsInside(neighborhoodIndex);
+      bool isInBounds = isInteriorPatch || this->m_TargetImageRegion.IsInside(neighborhoodIndex);
       if (isInBounds && std::isfinite(patchVectorY[count]))
       {
         auto x = static_cast<RealType>(imageList[i]->GetPixel(neighborhoodIndex));
@@ -249,6 +373,14 @@ NonLocalPatchBasedImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream
   }
 
   os << indent << "Neighborhood search radius = " << this->m_NeighborhoodSearchRadius << std::endl;
+  os << indent << "Search pattern = " << this->m_SearchPattern << std::endl;
+  os << indent << "Search pattern stride = " << this->m_SearchPatternStride << std::endl;
+  os << indent << "Number of custom search offsets = " << this->m_CustomNeighborhoodSearchOffsetList.size()
+     << std::endl;
+  os << indent << "Search strategy = " << this->m_SearchStrategy << std::endl;
+  os << indent << "Number of PatchMatch neighbors = " << this->m_NumberOfPatchMatchNeighbors << std::endl;
+  os << indent << "Number of PatchMatch iterations = " << this->m_NumberOfPatchMatchIterations << std::endl;
+  os << indent << "PatchMatch seed = " << this->m_PatchMatchSeed << std::endl;
   os << indent << "Neighborhood patch radius = " << this->m_NeighborhoodPatchRadius << std::endl;
 }
 
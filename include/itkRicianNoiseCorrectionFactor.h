@@ -0,0 +1,64 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkRicianNoiseCorrectionFactor_h
+#define itkRicianNoiseCorrectionFactor_h
+
+#include "AdaptiveDenoisingExport.h"
+
+namespace itk
+{
+
+/**
+ * \class RicianNoiseCorrectionFactor
+ * \brief Correction factor between the variance of Rician data and that of the underlying Gaussian noise.
+ *
+ * For a signal-to-noise ratio \f$\theta\f$ the factor is (Koay and Basser)
+ * \f[
+ *   \xi(\theta) = 2 + \theta^2 - \frac{\pi}{8} e^{-\theta^2/2}
+ *     \left( (2 + \theta^2) I_0(\theta^2/4) + \theta^2 I_1(\theta^2/4) \right)^2
+ * \f]
+ * Evaluate() interpolates linearly between exact values tabulated once, on a
+ * grid of spacing 1/SamplesPerUnitSNR, for ratios below MaximumTabulatedSNR.
+ * There the interpolation error is below MaximumInterpolationError.  Above
+ * it, where the exact expression suffers from cancellation and eventually
+ * overflows, the asymptotic expansion \f$1 - 1/(2\theta^2)\f$ is used.
+ *
+ * \ingroup AdaptiveDenoising
+ */
+class AdaptiveDenoising_EXPORT RicianNoiseCorrectionFactor
+{
+public:
+  static constexpr double       MaximumTabulatedSNR = 16.0;
+  static constexpr unsigned int SamplesPerUnitSNR = 128;
+  static constexpr double       MaximumInterpolationError = 5e-6;
+
+  /** Correction factor interpolated from the table. */
+  static double
+  Evaluate(double snr);
+
+  /**
+   * Correction factor evaluated with the modified Bessel functions of
+   * GaussianOperator.  Factors outside [0.001, 10] are replaced by 1.
+   */
+  static double
+  EvaluateExactly(double snr);
+};
+
+} // end namespace itk
+
+#endif
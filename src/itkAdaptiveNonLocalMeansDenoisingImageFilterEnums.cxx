@@ -0,0 +1,74 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAdaptiveNonLocalMeansDenoisingImageFilter.h"
+
+
+namespace itk
+{
+
+/** Print enum values */
+std::ostream &
+operator<<(std::ostream & out, const AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine::DIRECT:
+        return "itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine::DIRECT";
+      case AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine::SUMMED_AREA_TABLE:
+        return "itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine::SUMMED_AREA_TABLE";
+      default:
+        return "INVALID VALUE FOR itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine";
+    }
+  }();
+}
+
+std::ostream &
+operator<<(std::ostream & out, const AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother::DISCRETE_GAUSSIAN:
+        return "itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother::DISCRETE_GAUSSIAN";
+      case AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother::RECURSIVE_GAUSSIAN:
+        return "itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother::RECURSIVE_GAUSSIAN";
+      default:
+        return "INVALID VALUE FOR itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother";
+    }
+  }();
+}
+
+std::ostream &
+operator<<(std::ostream & out, const AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision::SINGLE:
+        return "itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision::SINGLE";
+      case AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision::HALF:
+        return "itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision::HALF";
+      default:
+        return "INVALID VALUE FOR itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision";
+    }
+  }();
+}
+
+} // end namespace itk
@@ -39,4 +39,40 @@ operator<<(std::ostream & out, const NonLocalPatchBasedImageFilterEnums::Similar
   }();
 }
 
+std::ostream &
+operator<<(std::ostream & out, const NonLocalPatchBasedImageFilterEnums::SearchPattern value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case NonLocalPatchBasedImageFilterEnums::SearchPattern::DENSE:
+        return "itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::DENSE";
+      case NonLocalPatchBasedImageFilterEnums::SearchPattern::STRIDED:
+        return "itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::STRIDED";
+      case NonLocalPatchBasedImageFilterEnums::SearchPattern::AXIAL:
+        return "itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::AXIAL";
+      case NonLocalPatchBasedImageFilterEnums::SearchPattern::RINGS:
+        return "itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::RINGS";
+      default:
+        return "INVALID VALUE FOR itk::NonLocalPatchBasedImageFilterEnums::SearchPattern";
+    }
+  }();
+}
+
+std::ostream &
+operator<<(std::ostream & out, const NonLocalPatchBasedImageFilterEnums::SearchStrategy value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case NonLocalPatchBasedImageFilterEnums::SearchStrategy::SEARCH_NEIGHBORHOOD:
+        return "itk::NonLocalPatchBasedImageFilterEnums::SearchStrategy::SEARCH_NEIGHBORHOOD";
+      case NonLocalPatchBasedImageFilterEnums::SearchStrategy::PATCH_MATCH:
+        return "itk::NonLocalPatchBasedImageFilterEnums::SearchStrategy::PATCH_MATCH";
+      default:
+        return "INVALID VALUE FOR itk::NonLocalPatchBasedImageFilterEnums::SearchStrategy";
+    }
+  }();
+}
+
 } // end namespace itk
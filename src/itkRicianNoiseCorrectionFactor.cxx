@@ -0,0 +1,72 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkRicianNoiseCorrectionFactor.h"
+#include "itkGaussianOperator.h"
+#include "itkMath.h"
+
+#include <vector>
+
+namespace itk
+{
+
+double
+RicianNoiseCorrectionFactor::Evaluate(double snr)
+{
+  snr = std::abs(snr);
+  if (!(snr < MaximumTabulatedSNR))
+  {
+    return 1.0 - 0.5 / itk::Math::sqr(snr);
+  }
+
+  // Built on first use; the initialization of a local static is thread safe.
+  static const std::vector<double> table = [] {
+    std::vector<double> values(static_cast<size_t>(MaximumTabulatedSNR * SamplesPerUnitSNR) + 1);
+    for (size_t i = 0; i < values.size(); i++)
+    {
+      values[i] = EvaluateExactly(static_cast<double>(i) / SamplesPerUnitSNR);
+    }
+    return values;
+  }();
+
+  const double position = snr * SamplesPerUnitSNR;
+  const auto   i = static_cast<size_t>(position);
+  const double fraction = position - static_cast<double>(i);
+  return table[i] + fraction * (table[i + 1] - table[i]);
+}
+
+double
+RicianNoiseCorrectionFactor::EvaluateExactly(double snr)
+{
+  GaussianOperator<double, 1> besselCalculator;
+
+  const double snrSquared = itk::Math::sqr(snr);
+  const double besselI0 = besselCalculator.ModifiedBesselI0(0.25 * snrSquared);
+  const double besselI1 = besselCalculator.ModifiedBesselI1(0.25 * snrSquared);
+
+  double value = 2.0 + snrSquared - 0.125 * Math::pi * std::exp(-0.5 * snrSquared) *
+                                        itk::Math::sqr((2.0 + snrSquared) * besselI0 + snrSquared * besselI1);
+
+  if (value < 0.001 || value > 10.0)
+  {
+    value = 1.0;
+  }
+  return value;
+}
+
+} // end namespace itk
@@ -16,11 +16,19 @@
  *
  *=========================================================================*/
 
+#include <cmath>
+#include <limits>
+#include <map>
 #include <set>
+#include <string>
 #include "itkAdaptiveNonLocalMeansDenoisingImageFilter.h"
 
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkStatisticsImageFilter.h"
+#include "itkStreamingImageFilter.h"
 #include "itkTestingMacros.h"
 #include "itkMath.h"
 
@@ -89,15 +97,124 @@ public:
   }
 };
 
+// Largest and mean absolute differences between two images over the buffered
+// region of the first one.  A NaN difference is reported as an infinite one.
+template <typename TImage>
+void
+ComputeImageDifference(const TImage * image1,
+                       const TImage * image2,
+                       double &       maximumDifference,
+                       double &       meanDifference)
+{
+  itk::ImageRegionConstIterator<TImage> It1(image1, image1->GetBufferedRegion());
+  itk::ImageRegionConstIterator<TImage> It2(image2, image1->GetBufferedRegion());
+
+  maximumDifference = 0.0;
+  meanDifference = 0.0;
+  for (; !It1.IsAtEnd(); ++It1, ++It2)
+  {
+    double difference = std::abs(static_cast<double>(It1.Get()) - static_cast<double>(It2.Get()));
+    if (!std::isfinite(difference))
+    {
+      difference = std::numeric_limits<double>::infinity();
+    }
+    maximumDifference = std::max(maximumDifference, difference);
+    meanDifference += difference;
+  }
+  meanDifference /= static_cast<double>(image1->GetBufferedRegion().GetNumberOfPixels());
+}
+
 int
 itkAdaptiveNonLocalMeansDenoisingImageFilterTest(int argc, char * argv[])
 {
-  if (argc < 4)
+  // The options follow the positional arguments, as "--name" for the
+  // switches and "--name value" for the others.
+  unsigned int patchDistanceEngineValue = 0;
+  unsigned int numberOfStreamDivisions = 1;
+  unsigned int numberOfChannels = 1;
+  unsigned int centerStrideValue = 1;
+  unsigned int ricianBiasSmootherValue = 1;
+  unsigned int searchPatternValue = 0;
+  unsigned int searchPatternStride = 3;
+  bool         useSearchOffsetList = false;
+  bool         useCoarseToFineSearch = false;
+  bool         useSymmetricPatchDistances = false;
+  bool         useMaskedExecution = false;
+  bool         useTiledTraversal = false;
+  bool         useParameterSweep = false;
+  bool         useIntermediateOutputs = false;
+  bool         useHalfPrecision = false;
+  bool         useRicianNoiseModel = false;
+  bool         usePatchMatch = false;
+  bool         skipPatchDistanceEarlyTermination = false;
+
+  const std::map<std::string, unsigned int *> valueOptions{ { "--patchDistanceEngine", &patchDistanceEngineValue },
+                                                            { "--streamDivisions", &numberOfStreamDivisions },
+                                                            { "--channels", &numberOfChannels },
+                                                            { "--centerStride", &centerStrideValue },
+                                                            { "--ricianBiasSmoother", &ricianBiasSmootherValue },
+                                                            { "--searchPattern", &searchPatternValue },
+                                                            { "--searchPatternStride", &searchPatternStride } };
+  const std::map<std::string, bool *> switchOptions{ { "--searchOffsetList", &useSearchOffsetList },
+                                                     { "--coarseToFineSearch", &useCoarseToFineSearch },
+                                                     { "--symmetricPatchDistances", &useSymmetricPatchDistances },
+                                                     { "--maskedExecution", &useMaskedExecution },
+                                                     { "--tiledTraversal", &useTiledTraversal },
+                                                     { "--parameterSweep", &useParameterSweep },
+                                                     { "--intermediateOutputs", &useIntermediateOutputs },
+                                                     { "--halfPrecision", &useHalfPrecision },
+                                                     { "--ricianNoiseModel", &useRicianNoiseModel },
+                                                     { "--patchMatch", &usePatchMatch },
+                                                     { "--noPatchDistanceEarlyTermination",
+                                                       &skipPatchDistanceEarlyTermination } };
+
+  bool areArgumentsValid = argc >= 4;
+  if (!areArgumentsValid)
   {
     std::cerr << "Missing parameters." << std::endl;
+  }
+  for (int i = 4; i < argc && areArgumentsValid; i++)
+  {
+    const auto valueOption = valueOptions.find(argv[i]);
+    const auto switchOption = switchOptions.find(argv[i]);
+    if (valueOption != valueOptions.end() && i + 1 < argc)
+    {
+      *valueOption->second = static_cast<unsigned int>(std::atoi(argv[++i]));
+    }
+    else if (switchOption != switchOptions.end())
+    {
+      *switchOption->second = true;
+    }
+    else
+    {
+      std::cerr << "Invalid option: " << argv[i] << std::endl;
+      areArgumentsValid = false;
+    }
+  }
+
+  if (!areArgumentsValid)
+  {
     std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv) << " inputImage"
               << " outputImage"
-              << " similarityMetric (0: PEARSON_CORRELATION; 1: MEAN_SQUARES)" << std::endl;
+              << " similarityMetric (0: PEARSON_CORRELATION; 1: MEAN_SQUARES)"
+              << " [--patchDistanceEngine (0: DIRECT; 1: SUMMED_AREA_TABLE)]"
+              << " [--streamDivisions numberOfStreamDivisions]"
+              << " [--channels numberOfChannels]"
+              << " [--searchOffsetList]"
+              << " [--coarseToFineSearch]"
+              << " [--symmetricPatchDistances]"
+              << " [--maskedExecution]"
+              << " [--tiledTraversal]"
+              << " [--parameterSweep]"
+              << " [--intermediateOutputs]"
+              << " [--halfPrecision]"
+              << " [--centerStride centerStride]"
+              << " [--ricianNoiseModel]"
+              << " [--ricianBiasSmoother (0: DISCRETE_GAUSSIAN; 1: RECURSIVE_GAUSSIAN)]"
+              << " [--searchPattern (0: DENSE; 1: STRIDED; 2: AXIAL; 3: RINGS)]"
+              << " [--searchPatternStride searchPatternStride]"
+              << " [--patchMatch]"
+              << " [--noPatchDistanceEarlyTermination]" << std::endl;
     return EXIT_FAILURE;
   }
 
@@ -115,8 +232,8 @@ itkAdaptiveNonLocalMeansDenoisingImageFilterTest(int argc, char * argv[])
   ITK_EXERCISE_BASIC_OBJECT_METHODS(filter, AdaptiveNonLocalMeansDenoisingImageFilter, NonLocalPatchBasedImageFilter);
 
   filter->SetInput(reader->GetOutput());
-  filter->SetUseRicianNoiseModel(false);
-  ITK_TEST_SET_GET_VALUE(false, filter->GetUseRicianNoiseModel());
+
+  ITK_TEST_SET_GET_BOOLEAN(filter, UseRicianNoiseModel, useRicianNoiseModel);
 
   DenoiserType::NeighborhoodRadiusType neighborhoodPatchRadius;
   DenoiserType::NeighborhoodRadiusType neighborhoodSearchRadius;
@@ -127,11 +244,58 @@ itkAdaptiveNonLocalMeansDenoisingImageFilterTest(int argc, char * argv[])
   filter->SetNeighborhoodSearchRadius(neighborhoodSearchRadius);
   filter->SetNeighborhoodPatchRadius(neighborhoodPatchRadius);
 
+  filter->SetSearchPatternStride(searchPatternStride);
+  ITK_TEST_SET_GET_VALUE(searchPatternStride, filter->GetSearchPatternStride());
+
+  auto searchPattern = static_cast<DenoiserType::SearchPatternEnum>(searchPatternValue);
+  filter->SetSearchPattern(searchPattern);
+  ITK_TEST_SET_GET_VALUE(searchPattern, filter->GetSearchPattern());
+
+  auto searchStrategy = usePatchMatch ? DenoiserType::SearchStrategyEnum::PATCH_MATCH
+                                      : DenoiserType::SearchStrategyEnum::SEARCH_NEIGHBORHOOD;
+  filter->SetSearchStrategy(searchStrategy);
+  ITK_TEST_SET_GET_VALUE(searchStrategy, filter->GetSearchStrategy());
+
+  filter->SetNumberOfPatchMatchNeighbors(8);
+  ITK_TEST_SET_GET_VALUE(8u, filter->GetNumberOfPatchMatchNeighbors());
+
+  filter->SetNumberOfPatchMatchIterations(4);
+  ITK_TEST_SET_GET_VALUE(4u, filter->GetNumberOfPatchMatchIterations());
+
+  filter->SetPatchMatchSeed(0);
+  ITK_TEST_SET_GET_VALUE(0u, filter->GetPatchMatchSeed());
+
+  // The whole search box given as a custom offset list must be searched like
+  // the dense search pattern, even without its center which is added back.
+  if (useSearchOffsetList)
+  {
+    DenoiserType::NeighborhoodType searchNeighborhood;
+    searchNeighborhood.SetRadius(neighborhoodSearchRadius);
+
+    DenoiserType::NeighborhoodOffsetListType searchOffsetList;
+    for (unsigned int n = 0; n < searchNeighborhood.Size(); n++)
+    {
+      if (n != searchNeighborhood.GetCenterNeighborhoodIndex())
+      {
+        searchOffsetList.push_back(searchNeighborhood.GetOffset(n));
+      }
+    }
+    filter->SetNeighborhoodSearchOffsetList(searchOffsetList);
+    ITK_TEST_EXPECT_EQUAL(searchOffsetList.size(), filter->GetNeighborhoodSearchOffsetList().size());
+  }
+
   DenoiserType::NeighborhoodRadiusType neighborhoodRadiusForLocalMeanAndVariance;
   neighborhoodRadiusForLocalMeanAndVariance.Fill(1);
 
   filter->SetNeighborhoodRadiusForLocalMeanAndVariance(neighborhoodRadiusForLocalMeanAndVariance);
 
+  // With a center stride, the overlapping patches of the centers must still
+  // cover every voxel.
+  DenoiserType::CenterStrideType centerStride;
+  centerStride.Fill(centerStrideValue);
+  filter->SetCenterStride(centerStride);
+  ITK_TEST_SET_GET_VALUE(centerStride, filter->GetCenterStride());
+
   filter->SetEpsilon(0.00001f);
   ITK_TEST_EXPECT_TRUE(itk::Math::FloatAlmostEqual(0.00001f, filter->GetEpsilon()));
 
@@ -147,23 +311,379 @@ itkAdaptiveNonLocalMeansDenoisingImageFilterTest(int argc, char * argv[])
   filter->SetSmoothingVariance(2.0f);
   ITK_TEST_EXPECT_TRUE(itk::Math::FloatAlmostEqual(2.0f, filter->GetSmoothingVariance()));
 
+  auto ricianBiasSmoother = static_cast<DenoiserType::RicianBiasSmootherEnum>(ricianBiasSmootherValue);
+  filter->SetRicianBiasSmoother(ricianBiasSmoother);
+  ITK_TEST_SET_GET_VALUE(ricianBiasSmoother, filter->GetRicianBiasSmoother());
+
   auto similarityMetric = static_cast<DenoiserType::SimilarityMetricEnum>(std::atoi(argv[3]));
   filter->SetSimilarityMetric(similarityMetric);
   ITK_TEST_SET_GET_VALUE(similarityMetric, filter->GetSimilarityMetric());
 
+  auto patchDistanceEngine = static_cast<DenoiserType::PatchDistanceEngineEnum>(patchDistanceEngineValue);
+  filter->SetPatchDistanceEngine(patchDistanceEngine);
+  ITK_TEST_SET_GET_VALUE(patchDistanceEngine, filter->GetPatchDistanceEngine());
+
+  // The early termination of the patch distances must not change the output.
+  ITK_TEST_SET_GET_BOOLEAN(filter, UsePatchDistanceEarlyTermination, !skipPatchDistanceEarlyTermination);
+
+  ITK_TEST_SET_GET_BOOLEAN(filter, UseSymmetricPatchDistances, useSymmetricPatchDistances);
+
+  // With as many candidates as coarse offsets, the coarse-to-fine search must
+  // visit every search offset.
+  ITK_TEST_SET_GET_BOOLEAN(filter, UseCoarseToFineSearch, useCoarseToFineSearch);
+
+  unsigned int numberOfCoarseSearchCandidates = useCoarseToFineSearch ? 1000 : 8;
+  filter->SetNumberOfCoarseSearchCandidates(numberOfCoarseSearchCandidates);
+  ITK_TEST_SET_GET_VALUE(numberOfCoarseSearchCandidates, filter->GetNumberOfCoarseSearchCandidates());
+
+  filter->SetCoarseSearchRefinementRadius(1);
+  ITK_TEST_SET_GET_VALUE(1u, filter->GetCoarseSearchRefinementRadius());
+
+  // Streaming requires the maximum intensity of the whole image up front.
+  ITK_TEST_SET_GET_BOOLEAN(filter, ComputeMaximumInputPixelIntensity, true);
+  if (numberOfStreamDivisions > 1)
+  {
+    using StatisticsFilterType = itk::StatisticsImageFilter<ImageType>;
+    StatisticsFilterType::Pointer statistics = StatisticsFilterType::New();
+    statistics->SetInput(reader->GetOutput());
+    ITK_TRY_EXPECT_NO_EXCEPTION(statistics->Update());
+
+    filter->ComputeMaximumInputPixelIntensityOff();
+    filter->SetMaximumInputPixelIntensity(statistics->GetMaximum());
+    ITK_TEST_SET_GET_VALUE(statistics->GetMaximum(), filter->GetMaximumInputPixelIntensity());
+  }
+
+  // Additional channels identical to the input share its patch weights, so
+  // they must be denoised exactly like the input.
+  for (unsigned int c = 1; c < numberOfChannels; c++)
+  {
+    filter->SetChannel(c, reader->GetOutput());
+    ITK_TEST_EXPECT_EQUAL(reader->GetOutput(), filter->GetChannel(c));
+  }
+  ITK_TEST_EXPECT_EQUAL(numberOfChannels, filter->GetNumberOfChannels());
+
+  // With the masked execution, only a disk in the middle of the image is
+  // denoised and the voxels outside it must keep their input intensity.
+  ITK_TEST_SET_GET_BOOLEAN(filter, UseMaskedExecution, useMaskedExecution);
+
+  // A small cache splits every slab into several tiles.
+  ITK_TEST_SET_GET_BOOLEAN(filter, UseTiledTraversal, useTiledTraversal);
+
+  filter->SetTileCacheSize(16384);
+  ITK_TEST_SET_GET_VALUE(16384u, filter->GetTileCacheSize());
+
+  // With a parameter sweep, the first parameter set is that of the filter,
+  // and the output of the second one must match a separate run.
+  DenoiserType::SweepParametersListType sweepParameters;
+  if (useParameterSweep)
+  {
+    DenoiserType::SweepParameters parameters;
+    parameters.m_SmoothingFactor = filter->GetSmoothingFactor();
+    parameters.m_MeanThreshold = filter->GetMeanThreshold();
+    parameters.m_VarianceThreshold = filter->GetVarianceThreshold();
+    parameters.m_SmoothingVariance = filter->GetSmoothingVariance();
+    sweepParameters.push_back(parameters);
+
+    parameters.m_SmoothingFactor = 1.5f;
+    parameters.m_MeanThreshold = 0.9f;
+    parameters.m_VarianceThreshold = 0.4f;
+    parameters.m_SmoothingVariance = 1.0f;
+    sweepParameters.push_back(parameters);
+  }
+  filter->SetSweepParameters(sweepParameters);
+  ITK_TEST_EXPECT_EQUAL(useParameterSweep ? 2u : 1u, filter->GetNumberOfParameterSets());
+
+  // The local statistics generated as intermediate outputs, given back to the
+  // filter, must reproduce its output.
+  ITK_TEST_SET_GET_BOOLEAN(filter, ComputeIntermediateOutputs, useIntermediateOutputs);
+
+  // With half precision auxiliary images, the output stays close to that of
+  // single precision: on r16slice the largest difference is 2.75, 1.3% of the
+  // intensity range, and the mean one 0.004.
+  auto auxiliaryImagePrecision = useHalfPrecision ? DenoiserType::AuxiliaryImagePrecisionEnum::HALF
+                                                  : DenoiserType::AuxiliaryImagePrecisionEnum::SINGLE;
+  filter->SetAuxiliaryImagePrecision(auxiliaryImagePrecision);
+  ITK_TEST_SET_GET_VALUE(auxiliaryImagePrecision, filter->GetAuxiliaryImagePrecision());
+
+  using MaskImageType = DenoiserType::MaskImageType;
+  MaskImageType::Pointer maskImage;
+  if (useMaskedExecution)
+  {
+    ITK_TRY_EXPECT_NO_EXCEPTION(reader->Update());
+
+    const ImageType::RegionType region = reader->GetOutput()->GetLargestPossibleRegion();
+
+    maskImage = MaskImageType::New();
+    maskImage->CopyInformation(reader->GetOutput());
+    maskImage->SetRegions(region);
+    maskImage->Allocate();
+
+    itk::ImageRegionIteratorWithIndex<MaskImageType> ItK(maskImage, region);
+    for (; !ItK.IsAtEnd(); ++ItK)
+    {
+      double squaredRadius = 0.0;
+      for (unsigned int d = 0; d < Dimension; d++)
+      {
+        const double distance = ItK.GetIndex()[d] - region.GetIndex(d) - 0.5 * region.GetSize(d);
+        squaredRadius += distance * distance / itk::Math::sqr(0.3 * region.GetSize(d));
+      }
+      ItK.Set(squaredRadius < 1.0 ? 1 : 0);
+    }
+    filter->SetMaskImage(maskImage);
+  }
+
   using CommandType = CommandProgressUpdate<DenoiserType>;
   CommandType::Pointer observer = CommandType::New();
   filter->AddObserver(itk::ProgressEvent(), observer);
 
-  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  using StreamerType = itk::StreamingImageFilter<ImageType, ImageType>;
+  StreamerType::Pointer streamer = StreamerType::New();
+  streamer->SetInput(filter->GetSweepOutput(0, numberOfChannels - 1));
+  streamer->SetNumberOfStreamDivisions(numberOfStreamDivisions);
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
 
   using WriterType = itk::ImageFileWriter<ImageType>;
   WriterType::Pointer writer = WriterType::New();
   writer->SetFileName(argv[2]);
-  writer->SetInput(filter->GetOutput());
+  writer->SetInput(streamer->GetOutput());
 
   ITK_TRY_EXPECT_NO_EXCEPTION(writer->Update());
 
+  // The search offsets are set up by the update.  The custom offset list gets
+  // its center back, and the sparse patterns keep the offsets described for
+  // SearchPattern.
+  {
+    const DenoiserType::NeighborhoodOffsetListType searchOffsetList = filter->GetNeighborhoodSearchOffsetList();
+
+    const auto radius = static_cast<itk::OffsetValueType>(neighborhoodSearchRadius[0]);
+    const auto stride = static_cast<itk::OffsetValueType>(searchPatternStride);
+    const auto coreRadius = std::min(radius, stride);
+
+    size_t numberOfDenseSearchOffsets = 1;
+    size_t numberOfStridedSearchOffsets = 1;
+    size_t numberOfCoreSearchOffsets = 1;
+    for (unsigned int d = 0; d < Dimension; d++)
+    {
+      numberOfDenseSearchOffsets *= 2 * radius + 1;
+      numberOfStridedSearchOffsets *= 2 * (radius / stride) + 1;
+      numberOfCoreSearchOffsets *= 2 * coreRadius + 1;
+    }
+
+    size_t numberOfSearchOffsetsInCore = 0;
+    for (const auto & offset : searchOffsetList)
+    {
+      itk::OffsetValueType distance = 0;
+      for (unsigned int d = 0; d < Dimension; d++)
+      {
+        distance = std::max(distance, std::abs(offset[d]));
+      }
+      numberOfSearchOffsetsInCore += (distance <= coreRadius);
+    }
+
+    switch (useSearchOffsetList ? DenoiserType::SearchPatternEnum::DENSE : searchPattern)
+    {
+      case DenoiserType::SearchPatternEnum::STRIDED:
+        ITK_TEST_EXPECT_EQUAL(numberOfStridedSearchOffsets, searchOffsetList.size());
+        break;
+      case DenoiserType::SearchPatternEnum::AXIAL:
+        ITK_TEST_EXPECT_EQUAL(static_cast<size_t>(2 * Dimension * radius + 1), searchOffsetList.size());
+        break;
+      case DenoiserType::SearchPatternEnum::RINGS:
+        ITK_TEST_EXPECT_EQUAL(numberOfCoreSearchOffsets, numberOfSearchOffsetsInCore);
+        ITK_TEST_EXPECT_TRUE(radius <= stride || searchOffsetList.size() < numberOfDenseSearchOffsets);
+        break;
+      case DenoiserType::SearchPatternEnum::DENSE:
+      default:
+        ITK_TEST_EXPECT_EQUAL(numberOfDenseSearchOffsets, searchOffsetList.size());
+        break;
+    }
+  }
+
+  // The approximate modes are checked against the exact computation relative
+  // to the intensity range of the input image.
+  using StatisticsFilterType = itk::StatisticsImageFilter<ImageType>;
+  StatisticsFilterType::Pointer intensityStatistics = StatisticsFilterType::New();
+  intensityStatistics->SetInput(reader->GetOutput());
+  ITK_TRY_EXPECT_NO_EXCEPTION(intensityStatistics->Update());
+  const double intensityRange = intensityStatistics->GetMaximum() - intensityStatistics->GetMinimum();
+
+  double maximumDifference = 0.0;
+  double meanDifference = 0.0;
+
+  if (useMaskedExecution)
+  {
+    const ImageType::RegionType region = streamer->GetOutput()->GetBufferedRegion();
+
+    itk::ImageRegionConstIterator<ImageType>     ItO(streamer->GetOutput(), region);
+    itk::ImageRegionConstIterator<ImageType>     ItI(reader->GetOutput(), region);
+    itk::ImageRegionConstIterator<MaskImageType> ItK(maskImage, region);
+
+    bool isInputKept = true;
+    for (; !ItO.IsAtEnd(); ++ItO, ++ItI, ++ItK)
+    {
+      isInputKept = isInputKept && (ItK.Get() != 0 || ItO.Get() == ItI.Get());
+    }
+    ITK_TEST_EXPECT_TRUE(isInputKept);
+  }
+
+  if (useParameterSweep)
+  {
+    ImageType::Pointer sweepOutput = filter->GetSweepOutput(1, numberOfChannels - 1);
+    sweepOutput->DisconnectPipeline();
+
+    filter->SetSweepParameters(DenoiserType::SweepParametersListType(1, sweepParameters[1]));
+    ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+
+    itk::ImageRegionConstIterator<ImageType> ItS(sweepOutput, sweepOutput->GetBufferedRegion());
+    itk::ImageRegionConstIterator<ImageType> ItO(filter->GetOutput(numberOfChannels - 1),
+                                                 sweepOutput->GetBufferedRegion());
+
+    bool isSweepOutputIdentical = true;
+    for (; !ItS.IsAtEnd(); ++ItS, ++ItO)
+    {
+      isSweepOutputIdentical = isSweepOutputIdentical && ItS.Get() == ItO.Get();
+    }
+    ITK_TEST_EXPECT_TRUE(isSweepOutputIdentical);
+  }
+
+  if (useIntermediateOutputs)
+  {
+    using RealImageType = DenoiserType::RealImageType;
+
+    ITK_TRY_EXPECT_NO_EXCEPTION(filter->UpdateLargestPossibleRegion());
+
+    ImageType::Pointer output = filter->GetOutput(numberOfChannels - 1);
+    output->DisconnectPipeline();
+    RealImageType::Pointer localMean = filter->GetLocalMeanOutput();
+    localMean->DisconnectPipeline();
+    RealImageType::Pointer localVariance = filter->GetLocalVarianceOutput();
+    localVariance->DisconnectPipeline();
+    ITK_TEST_EXPECT_EQUAL(output->GetBufferedRegion(), localMean->GetBufferedRegion());
+    ITK_TEST_EXPECT_EQUAL(output->GetBufferedRegion(), localVariance->GetBufferedRegion());
+
+    filter->SetLocalMeanImage(localMean);
+    ITK_TEST_EXPECT_EQUAL(localMean.GetPointer(), filter->GetLocalMeanImage());
+    filter->SetLocalVarianceImage(localVariance);
+    ITK_TEST_EXPECT_EQUAL(localVariance.GetPointer(), filter->GetLocalVarianceImage());
+    ITK_TRY_EXPECT_NO_EXCEPTION(filter->UpdateLargestPossibleRegion());
+
+    itk::ImageRegionConstIterator<ImageType> ItP(output, output->GetBufferedRegion());
+    itk::ImageRegionConstIterator<ImageType> ItO(filter->GetOutput(numberOfChannels - 1), output->GetBufferedRegion());
+
+    bool isOutputIdentical = true;
+    for (; !ItP.IsAtEnd(); ++ItP, ++ItO)
+    {
+      isOutputIdentical = isOutputIdentical && ItP.Get() == ItO.Get();
+    }
+    ITK_TEST_EXPECT_TRUE(isOutputIdentical);
+
+    filter->SetLocalVarianceImage(nullptr);
+    ITK_TRY_EXPECT_EXCEPTION(filter->UpdateLargestPossibleRegion());
+  }
+
+  // Every voxel must be covered (a voxel left out has no contribution and is
+  // not finite), and the blockwise estimates stay close to the pointwise ones:
+  // on r16slice with a stride of 2 the mean difference is 0.36% of the
+  // intensity range and the largest one 11.9%.
+  if (centerStride[0] > 1)
+  {
+    ImageType::Pointer output = streamer->GetOutput();
+    output->DisconnectPipeline();
+
+    centerStride.Fill(1);
+    filter->SetCenterStride(centerStride);
+    ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+    ComputeImageDifference<ImageType>(output, streamer->GetOutput(), maximumDifference, meanDifference);
+    std::cout << "Differences with a center stride of 1: " << maximumDifference << " (maximum), " << meanDifference
+              << " (mean)" << std::endl;
+    ITK_TEST_EXPECT_TRUE(maximumDifference <= 0.15 * intensityRange);
+    ITK_TEST_EXPECT_TRUE(meanDifference <= 0.005 * intensityRange);
+  }
+
+  // The two smoothers of the Rician bias map differ through the truncation of
+  // the discrete kernel, with and without a mask: on r16slice the outputs
+  // differ by less than 1.5% of the intensity range at any voxel, and by
+  // about 0.01% on average.
+  if (useRicianNoiseModel)
+  {
+    ImageType::Pointer output = streamer->GetOutput();
+    output->DisconnectPipeline();
+
+    filter->SetRicianBiasSmoother(ricianBiasSmoother == DenoiserType::RicianBiasSmootherEnum::DISCRETE_GAUSSIAN
+                                    ? DenoiserType::RicianBiasSmootherEnum::RECURSIVE_GAUSSIAN
+                                    : DenoiserType::RicianBiasSmootherEnum::DISCRETE_GAUSSIAN);
+    ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+    ComputeImageDifference<ImageType>(output, streamer->GetOutput(), maximumDifference, meanDifference);
+    std::cout << "Differences with the other Rician bias smoother: " << maximumDifference << " (maximum), "
+              << meanDifference << " (mean)" << std::endl;
+    ITK_TEST_EXPECT_TRUE(maximumDifference <= 0.015 * intensityRange);
+    ITK_TEST_EXPECT_TRUE(meanDifference <= 0.0001 * intensityRange);
+
+    filter->SetRicianBiasSmoother(ricianBiasSmoother);
+  }
+
+  // With a fixed seed, PatchMatch must give the same output whatever the
+  // number of work units and the streaming.  It finds other neighbors than
+  // the search neighborhood: on r16slice the mean difference with the dense
+  // search is 0.31% of the intensity range and the largest one 8.8%.
+  if (usePatchMatch)
+  {
+    ImageType::Pointer output = streamer->GetOutput();
+    output->DisconnectPipeline();
+
+    filter->SetNumberOfWorkUnits(1);
+    ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+    ComputeImageDifference<ImageType>(output, streamer->GetOutput(), maximumDifference, meanDifference);
+    ITK_TEST_EXPECT_EQUAL(0.0, maximumDifference);
+
+    filter->SetNumberOfWorkUnits(3);
+    filter->ComputeMaximumInputPixelIntensityOff();
+    filter->SetMaximumInputPixelIntensity(intensityStatistics->GetMaximum());
+    streamer->SetNumberOfStreamDivisions(numberOfStreamDivisions + 2);
+    ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+    ComputeImageDifference<ImageType>(output, streamer->GetOutput(), maximumDifference, meanDifference);
+    ITK_TEST_EXPECT_EQUAL(0.0, maximumDifference);
+
+    // The symmetric patch distances are not reused with PatchMatch, whose
+    // search offsets change from one center to the next.
+    filter->SetUseSymmetricPatchDistances(!useSymmetricPatchDistances);
+    ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+    ComputeImageDifference<ImageType>(output, streamer->GetOutput(), maximumDifference, meanDifference);
+    ITK_TEST_EXPECT_EQUAL(0.0, maximumDifference);
+
+    filter->SetUseSymmetricPatchDistances(useSymmetricPatchDistances);
+    filter->SetSearchStrategy(DenoiserType::SearchStrategyEnum::SEARCH_NEIGHBORHOOD);
+    ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+    ComputeImageDifference<ImageType>(output, streamer->GetOutput(), maximumDifference, meanDifference);
+    std::cout << "Differences with the search neighborhood: " << maximumDifference << " (maximum), "
+              << meanDifference << " (mean)" << std::endl;
+    ITK_TEST_EXPECT_TRUE(maximumDifference <= 0.15 * intensityRange);
+    ITK_TEST_EXPECT_TRUE(meanDifference <= 0.005 * intensityRange);
+  }
+
+  if (useHalfPrecision)
+  {
+    ImageType::Pointer output = streamer->GetOutput();
+    output->DisconnectPipeline();
+
+    filter->SetAuxiliaryImagePrecision(DenoiserType::AuxiliaryImagePrecisionEnum::SINGLE);
+    ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+    ComputeImageDifference<ImageType>(output, streamer->GetOutput(), maximumDifference, meanDifference);
+    std::cout << "Maximum difference with single precision: " << maximumDifference << std::endl;
+    ITK_TEST_EXPECT_TRUE(maximumDifference <= 0.015 * intensityRange);
+
+    filter->SetAuxiliaryImagePrecision(DenoiserType::AuxiliaryImagePrecisionEnum::HALF);
+    filter->SetPatchDistanceEngine(DenoiserType::PatchDistanceEngineEnum::SUMMED_AREA_TABLE);
+    ITK_TRY_EXPECT_EXCEPTION(filter->Update());
+  }
 
   // Test streaming enumeration for NonLocalPatchBasedImageFilterEnums::SimilarityMetric elements
   const std::set<itk::NonLocalPatchBasedImageFilterEnums::SimilarityMetric> allSimilarityMetric{
@@ -175,6 +695,60 @@ itkAdaptiveNonLocalMeansDenoisingImageFilterTest(int argc, char * argv[])
     std::cout << "STREAMED ENUM VALUE NonLocalPatchBasedImageFilterEnums::SimilarityMetric: " << ee << std::endl;
   }
 
+  // Test streaming enumeration for NonLocalPatchBasedImageFilterEnums::SearchPattern elements
+  const std::set<itk::NonLocalPatchBasedImageFilterEnums::SearchPattern> allSearchPattern{
+    itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::DENSE,
+    itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::STRIDED,
+    itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::AXIAL,
+    itk::NonLocalPatchBasedImageFilterEnums::SearchPattern::RINGS
+  };
+  for (const auto & ee : allSearchPattern)
+  {
+    std::cout << "STREAMED ENUM VALUE NonLocalPatchBasedImageFilterEnums::SearchPattern: " << ee << std::endl;
+  }
+
+  // Test streaming enumeration for NonLocalPatchBasedImageFilterEnums::SearchStrategy elements
+  const std::set<itk::NonLocalPatchBasedImageFilterEnums::SearchStrategy> allSearchStrategy{
+    itk::NonLocalPatchBasedImageFilterEnums::SearchStrategy::SEARCH_NEIGHBORHOOD,
+    itk::NonLocalPatchBasedImageFilterEnums::SearchStrategy::PATCH_MATCH
+  };
+  for (const auto & ee : allSearchStrategy)
+  {
+    std::cout << "STREAMED ENUM VALUE NonLocalPatchBasedImageFilterEnums::SearchStrategy: " << ee << std::endl;
+  }
+
+  // Test streaming enumeration for AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine elements
+  const std::set<itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine> allPatchDistanceEngine{
+    itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine::DIRECT,
+    itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine::SUMMED_AREA_TABLE
+  };
+  for (const auto & ee : allPatchDistanceEngine)
+  {
+    std::cout << "STREAMED ENUM VALUE AdaptiveNonLocalMeansDenoisingImageFilterEnums::PatchDistanceEngine: " << ee
+              << std::endl;
+  }
+
+  // Test streaming enumeration for AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother elements
+  const std::set<itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother> allRicianBiasSmoother{
+    itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother::DISCRETE_GAUSSIAN,
+    itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother::RECURSIVE_GAUSSIAN
+  };
+  for (const auto & ee : allRicianBiasSmoother)
+  {
+    std::cout << "STREAMED ENUM VALUE AdaptiveNonLocalMeansDenoisingImageFilterEnums::RicianBiasSmoother: " << ee
+              << std::endl;
+  }
+
+  // Test streaming enumeration for AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision elements
+  const std::set<itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision>
+    allAuxiliaryImagePrecision{ itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision::SINGLE,
+                                itk::AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision::HALF };
+  for (const auto & ee : allAuxiliaryImagePrecision)
+  {
+    std::cout << "STREAMED ENUM VALUE AdaptiveNonLocalMeansDenoisingImageFilterEnums::AuxiliaryImagePrecision: " << ee
+              << std::endl;
+  }
+
 
   std::cout << "Test finished" << std::endl;
   return EXIT_SUCCESS;
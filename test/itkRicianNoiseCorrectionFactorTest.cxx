@@ -0,0 +1,73 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkRicianNoiseCorrectionFactor.h"
+
+#include "itkTestingMacros.h"
+#include "itkMath.h"
+
+int
+itkRicianNoiseCorrectionFactorTest(int, char *[])
+{
+  using CorrectionFactorType = itk::RicianNoiseCorrectionFactor;
+
+  // The interpolated factor, sampled between and at the nodes of the table,
+  // must stay within the stated bound of the exact factor.
+  constexpr unsigned int samplesPerNode = 7;
+  const unsigned int     numberOfSamples = static_cast<unsigned int>(
+    CorrectionFactorType::MaximumTabulatedSNR * CorrectionFactorType::SamplesPerUnitSNR * samplesPerNode);
+
+  double maximumError = 0.0;
+  double snrAtMaximumError = 0.0;
+  for (unsigned int i = 0; i < numberOfSamples; i++)
+  {
+    const double snr = static_cast<double>(i) / (CorrectionFactorType::SamplesPerUnitSNR * samplesPerNode);
+    const double error = std::abs(CorrectionFactorType::Evaluate(snr) - CorrectionFactorType::EvaluateExactly(snr));
+    if (error > maximumError)
+    {
+      maximumError = error;
+      snrAtMaximumError = snr;
+    }
+  }
+  std::cout << "Maximum interpolation error: " << maximumError << " (SNR = " << snrAtMaximumError << ")"
+            << std::endl;
+  ITK_TEST_EXPECT_TRUE(maximumError <= CorrectionFactorType::MaximumInterpolationError);
+
+  // Known values of the exact factor.
+  const double factorAtZero = 2.0 - 0.5 * itk::Math::pi;
+  ITK_TEST_EXPECT_TRUE(itk::Math::FloatAlmostEqual(CorrectionFactorType::EvaluateExactly(0.0), factorAtZero, 4, 1e-6));
+  ITK_TEST_EXPECT_TRUE(itk::Math::FloatAlmostEqual(CorrectionFactorType::Evaluate(0.0), factorAtZero, 4, 1e-6));
+
+  // The factor only depends on the magnitude of the SNR.
+  ITK_TEST_EXPECT_EQUAL(CorrectionFactorType::Evaluate(-2.5), CorrectionFactorType::Evaluate(2.5));
+
+  // The asymptotic expansion used beyond the table joins the exact factor.
+  const double snr = CorrectionFactorType::MaximumTabulatedSNR;
+  ITK_TEST_EXPECT_TRUE(itk::Math::FloatAlmostEqual(
+    CorrectionFactorType::Evaluate(snr), CorrectionFactorType::EvaluateExactly(snr), 4, 1e-4));
+
+  // Beyond the range of the exact evaluation the factor tends to one.
+  for (const double largeSNR : { 20.0, 50.0, 1e3 })
+  {
+    const double value = CorrectionFactorType::Evaluate(largeSNR);
+    ITK_TEST_EXPECT_TRUE(value < 1.0 && value > 0.99);
+  }
+
+  std::cout << "Test finished" << std::endl;
+  return EXIT_SUCCESS;
+}